@@ -28,6 +28,7 @@
 #include <mem/heap.h>
 #include <mem/mc.h>
 #include <mem/minerva.h>
+#include <mem/pool.h>
 #include <mem/sdram.h>
 #include <mem/smmu.h>
 #include <module.h>
@@ -913,6 +913,15 @@ void display_set_framebuffer(u32 window, void *fb)
 	DISPLAY_A(_DIREG(DC_CMD_STATE_CONTROL)) = GENERAL_ACT_REQ | BIT(WIN_ACT_REQ + window);
 }
 
+void display_wait_framebuffer(u32 window)
+{
+	// Activation requests clear once the armed state is latched at frame start.
+	u32 end = get_tmr_us() + 50000; // 3 frames.
+	while (get_tmr_us() < end &&
+		   DISPLAY_A(_DIREG(DC_CMD_STATE_CONTROL)) & (GENERAL_ACT_REQ | BIT(WIN_ACT_REQ + window)))
+		;
+}
+
 void display_move_framebuffer(u32 window, void *fb)
 {
 	// Select window.
@@ -899,6 +899,7 @@ void display_window_disable(u32 window);
 
 void display_set_framebuffer(u32 window,  void *fb);
 void display_move_framebuffer(u32 window, void *fb);
+void display_wait_framebuffer(u32 window);
 
 void display_window_d_console_enable();
 void display_window_d_console_disable();
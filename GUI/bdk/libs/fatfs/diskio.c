@@ -86,6 +86,9 @@ DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff) {
       return RES_NOTRDY;
     switch (cmd) {
     case CTRL_SYNC:
+      /* Commit data held in the card's volatile cache */
+      if (sd_storage.ser.cache_en && !sd_storage_cache_flush(&sd_storage))
+        return RES_ERROR;
       return RES_OK;
     case GET_SECTOR_COUNT:
       *(DWORD *)buff = sd_storage.sec_cnt;
@@ -96,6 +99,17 @@ DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff) {
     case GET_BLOCK_SIZE:
       *(DWORD *)buff = 32768; /* 32KB erase block */
       return RES_OK;
+    case CTRL_TRIM: {
+      /* Discard freed clusters. Without discard support they are left as is,
+         a full erase would block deletes for the whole erase timeout */
+      if (!sd_storage.ssr.discard)
+        return RES_OK;
+      DWORD *range = (DWORD *)buff;
+      u32 num = range[1] - range[0] + 1;
+      if (sd_storage_erase(&sd_storage, range[0], num, SD_DISCARD_ARG))
+        return RES_OK;
+      return RES_ERROR;
+    }
     default:
       return RES_PARERR;
     }
@@ -64,6 +64,9 @@
 /*Screen refresh period in milliseconds*/
 #define LV_REFR_PERIOD      33
 
+/*Invalidated areas buffered per refresh. More than this redraws the whole screen*/
+#define LV_INV_FIFO_SIZE    32
+
 /*-----------------
  *  VDB settings
  *----------------*/
@@ -283,7 +286,7 @@
 #define USE_LV_GAUGE    0
 
 /*Chart (dependencies: -)*/
-#define USE_LV_CHART    0
+#define USE_LV_CHART    1
 
 /*Table (dependencies: lv_label)*/
 #define USE_LV_TABLE    1
@@ -53,6 +53,7 @@ static uint16_t inv_buf_p;
 static void (*monitor_cb)(uint32_t, uint32_t); /*Monitor the rendering time*/
 static void (*round_cb)(lv_area_t *);          /*If set then called to modify invalidated areas for special display controllers*/
 static uint32_t px_num;
+static uint16_t join_num;
 
 /**********************
  *      MACROS
@@ -143,6 +144,16 @@ void lv_refr_set_monitor_cb(void (*cb)(uint32_t, uint32_t))
     monitor_cb = cb;
 }
 
+/**
+ * Get the number of invalidated areas joined into others in the last refresh.
+ * Valid in the monitor callback.
+ * @return number of joined areas
+ */
+uint16_t lv_refr_get_joined_num(void)
+{
+    return join_num;
+}
+
 /**
  * Called when an area is invalidated to modify the coordinates of the area.
  * Special display controllers may require special coordinate rounding
@@ -258,6 +269,7 @@ static void lv_refr_join_area(void)
     uint32_t join_from;
     uint32_t join_in;
     lv_area_t joined_area;
+    join_num = 0;
     for(join_in = 0; join_in < inv_buf_p; join_in++) {
         if(inv_buf[join_in].joined != 0) continue;
 
@@ -284,6 +296,7 @@ static void lv_refr_join_area(void)
 
                 /*Mark 'join_form' is joined into 'join_in'*/
                 inv_buf[join_from].joined = 1;
+                join_num++;
             }
         }
     }
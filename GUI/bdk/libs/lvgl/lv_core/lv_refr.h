@@ -64,6 +64,13 @@ void lv_inv_area(const lv_area_t * area_p);
  */
 void lv_refr_set_monitor_cb(void (*cb)(uint32_t, uint32_t));
 
+/**
+ * Get the number of invalidated areas joined into others in the last refresh.
+ * Valid in the monitor callback.
+ * @return number of joined areas
+ */
+uint16_t lv_refr_get_joined_num(void);
+
 /**
  * Called when an area is invalidated to modify the coordinates of the area.
  * Special display controllers may require special coordinate rounding
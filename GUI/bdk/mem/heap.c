@@ -21,13 +21,107 @@
 
 heap_t _heap;
 
+#ifdef BDK_MALLOC_TRACK
+#define HEAP_CALLER() ((u32)__builtin_return_address(0))
+#else
+#define HEAP_CALLER() 0
+#endif
+
 static void _heap_create(void *start)
 {
+	memset(&_heap, 0, sizeof(heap_t));
 	_heap.start = start;
-	_heap.first = NULL;
-	_heap.last = NULL;
 }
 
+#ifndef BDK_MALLOC_NO_DEFRAG
+static u32 _heap_fls(u32 val)
+{
+	return 31 - __builtin_clz(val);
+}
+
+// Size to first and second level class indices.
+static void _heap_mapping(u32 size, u32 *fl, u32 *sl)
+{
+	if (size < (1 << HEAP_FL_SHIFT))
+	{
+		*fl = 0;
+		*sl = size >> HEAP_ALIGN_SHIFT;
+	}
+	else
+	{
+		u32 bit = _heap_fls(size);
+		*sl = (size >> (bit - HEAP_SL_SHIFT)) ^ HEAP_SL_COUNT;
+		*fl = bit - HEAP_FL_SHIFT + 1;
+	}
+}
+
+static void _heap_insert_free(hnode_t *node)
+{
+	u32 fl, sl;
+	_heap_mapping(node->size, &fl, &sl);
+
+	node->free_prev = NULL;
+	node->free_next = _heap.free[fl][sl];
+	if (node->free_next)
+		node->free_next->free_prev = node;
+	_heap.free[fl][sl] = node;
+
+	_heap.fl_bitmap     |= BIT(fl);
+	_heap.sl_bitmap[fl] |= BIT(sl);
+}
+
+static void _heap_remove_free(hnode_t *node)
+{
+	u32 fl, sl;
+	_heap_mapping(node->size, &fl, &sl);
+
+	if (node->free_next)
+		node->free_next->free_prev = node->free_prev;
+	if (node->free_prev)
+		node->free_prev->free_next = node->free_next;
+	else
+	{
+		_heap.free[fl][sl] = node->free_next;
+
+		// Clear class bits if its list is now empty.
+		if (!node->free_next)
+		{
+			_heap.sl_bitmap[fl] &= ~BIT(sl);
+			if (!_heap.sl_bitmap[fl])
+				_heap.fl_bitmap &= ~BIT(fl);
+		}
+	}
+}
+
+// Returns a free node of at least size bytes from the first non empty fitting class.
+static hnode_t *_heap_find_free(u32 size)
+{
+	u32 fl, sl;
+
+	// Round up to the next class so any node in it fits.
+	if (size >= (1 << HEAP_FL_SHIFT))
+		size += (1 << (_heap_fls(size) - HEAP_SL_SHIFT)) - 1;
+	_heap_mapping(size, &fl, &sl);
+
+	if (fl >= HEAP_FL_COUNT)
+		return NULL;
+
+	u32 sl_map = _heap.sl_bitmap[fl] & (~0U << sl);
+	if (!sl_map)
+	{
+		u32 fl_map = _heap.fl_bitmap & (~0U << (fl + 1));
+		if (!fl_map)
+			return NULL;
+
+		fl = __builtin_ctz(fl_map);
+		sl_map = _heap.sl_bitmap[fl];
+	}
+	sl = __builtin_ctz(sl_map);
+
+	return _heap.free[fl][sl];
+}
+#endif
+
 // Node info is before node address.
 static void *_heap_alloc(u32 size)
 {
@@ -51,50 +145,57 @@ static void *_heap_alloc(u32 size)
 		return (void *)node + sizeof(hnode_t);
 	}
 
-#ifdef BDK_MALLOC_NO_DEFRAG
 	// Get the last allocated block.
 	node = _heap.last;
-#else
-	// Get first block and find the first available one.
-	node = _heap.first;
-	while (true)
+
+#ifndef BDK_MALLOC_NO_DEFRAG
+	// Get a free block from the smallest fitting size class.
+	new_node = _heap_find_free(size);
+	if (new_node)
 	{
-		// Check if there's available unused node.
-		if (!node->used && (size <= node->size))
-		{
-			// Size and offset of the new unused node.
-			u32 new_size = node->size - size;
-			new_node = (hnode_t *)((void *)node + sizeof(hnode_t) + size);
+		node = new_node;
+		_heap_remove_free(node);
 
-			// If there's aligned unused space from the old node,
-			// create a new one and set the leftover size.
-			if (new_size >= (sizeof(hnode_t) << 2))
-			{
-				new_node->size = new_size - sizeof(hnode_t);
-				new_node->used = 0;
-				new_node->next = node->next;
+		// Size and offset of the new unused node.
+		u32 new_size = node->size - size;
+		new_node = (hnode_t *)((void *)node + sizeof(hnode_t) + size);
 
-				// Check that we are not on first node.
-				if (new_node->next)
-					new_node->next->prev = new_node;
+		// If there's aligned unused space from the old node,
+		// create a new one and set the leftover size.
+		if (new_size >= (sizeof(hnode_t) << 2))
+		{
+			new_node->size = new_size - sizeof(hnode_t);
+			new_node->used = 0;
+			new_node->next = node->next;
 
-				new_node->prev = node;
-				node->next = new_node;
-			}
-			else // Unused node size is just enough.
-				size += new_size;
+			// Check that we are not on last node.
+			if (new_node->next)
+				new_node->next->prev = new_node;
+			else
+				_heap.last = new_node;
 
-			node->size = size;
-			node->used = 1;
+			new_node->prev = node;
+			node->next = new_node;
 
-			return (void *)node + sizeof(hnode_t);
+			_heap_insert_free(new_node);
 		}
+		else // Unused node size is just enough.
+			size += new_size;
 
-		// No unused node found, try the next one.
-		if (node->next)
-			node = node->next;
-		else
-			break;
+		node->size = size;
+		node->used = 1;
+
+		return (void *)node + sizeof(hnode_t);
+	}
+
+	// Last block is free but too small. Grow it into the unused heap space.
+	if (!node->used)
+	{
+		_heap_remove_free(node);
+		node->size = size;
+		node->used = 1;
+
+		return (void *)node + sizeof(hnode_t);
 	}
 #endif
 
@@ -111,29 +212,68 @@ static void *_heap_alloc(u32 size)
 	return (void *)new_node + sizeof(hnode_t);
 }
 
+static void *_heap_alloc_tagged(u32 size, u32 tag)
+{
+	void *buf = _heap_alloc(size);
+	hnode_t *node = (hnode_t *)(buf - sizeof(hnode_t));
+
+	_heap.used += node->size + sizeof(hnode_t);
+	if (_heap.used > _heap.peak)
+		_heap.peak = _heap.used;
+	_heap.allocs++;
+
+#ifdef BDK_MALLOC_TRACK
+	node->tag = tag;
+	node->serial = _heap.serial++;
+#endif
+
+	return buf;
+}
+
 static void _heap_free(void *addr)
 {
 	hnode_t *node = (hnode_t *)(addr - sizeof(hnode_t));
+
+	// Ignore double frees.
+	if (!node->used)
+		return;
+
 	node->used = 0;
-	node = _heap.first;
+	_heap.used -= node->size + sizeof(hnode_t);
+	_heap.allocs--;
 
 #ifndef BDK_MALLOC_NO_DEFRAG
-	// Do simple defragmentation on next blocks.
-	while (node)
+	// Coalesce with the next block.
+	hnode_t *next = node->next;
+	if (next && !next->used)
 	{
-		if (!node->used)
-		{
-			if (node->prev && !node->prev->used)
-			{
-				node->prev->size += node->size + sizeof(hnode_t);
-				node->prev->next = node->next;
+		_heap_remove_free(next);
+		node->size += next->size + sizeof(hnode_t);
+		node->next = next->next;
 
-				if (node->next)
-					node->next->prev = node->prev;
-			}
-		}
-		node = node->next;
+		if (node->next)
+			node->next->prev = node;
+		else
+			_heap.last = node;
 	}
+
+	// Coalesce with the previous block.
+	hnode_t *prev = node->prev;
+	if (prev && !prev->used)
+	{
+		_heap_remove_free(prev);
+		prev->size += node->size + sizeof(hnode_t);
+		prev->next = node->next;
+
+		if (prev->next)
+			prev->next->prev = prev;
+		else
+			_heap.last = prev;
+
+		node = prev;
+	}
+
+	_heap_insert_free(node);
 #endif
 }
 
@@ -149,19 +289,19 @@ void heap_set(heap_t *heap)
 
 void *malloc(u32 size)
 {
-	return _heap_alloc(size);
+	return _heap_alloc_tagged(size, HEAP_CALLER());
 }
 
 void *calloc(u32 num, u32 size)
 {
-	void *res = (void *)_heap_alloc(num * size);
+	void *res = (void *)_heap_alloc_tagged(num * size, HEAP_CALLER());
 	memset(res, 0, ALIGN(num * size, sizeof(hnode_t))); // Clear the aligned size.
 	return res;
 }
 
 void *zalloc(u32 size)
 {
-	void *res = (void *)_heap_alloc(size);
+	void *res = (void *)_heap_alloc_tagged(size, HEAP_CALLER());
 	memset(res, 0, ALIGN(size, sizeof(hnode_t))); // Clear the aligned size.
 	return res;
 }
@@ -202,3 +342,100 @@ void heap_monitor(heap_monitor_t *mon, bool print_node_stats)
 	mon->total += mon->used;
 	mon->nodes_total = count;
 }
+
+void heap_get_stats(heap_stats_t *stats)
+{
+	memset(stats, 0, sizeof(heap_stats_t));
+	stats->used   = _heap.used;
+	stats->peak   = _heap.peak;
+	stats->allocs = _heap.allocs;
+
+	if (!_heap.first)
+		return;
+
+	u32 top = (u32)_heap.last + sizeof(hnode_t) + _heap.last->size;
+	stats->free = top - (u32)_heap.start - _heap.used;
+
+#ifndef BDK_MALLOC_NO_DEFRAG
+	// The largest free node is in the highest non empty class.
+	if (_heap.fl_bitmap)
+	{
+		u32 fl = 31 - __builtin_clz(_heap.fl_bitmap);
+		u32 sl = 31 - __builtin_clz(_heap.sl_bitmap[fl]);
+		for (hnode_t *node = _heap.free[fl][sl]; node; node = node->free_next)
+			if (node->size > stats->largest_free)
+				stats->largest_free = node->size;
+	}
+#endif
+
+	if (stats->free)
+		stats->frag = (u64)(stats->free - stats->largest_free) * 1000 / stats->free;
+}
+
+#ifdef BDK_MALLOC_TRACK
+// Returns the serial of the next allocation, to report only what is allocated after it.
+u32 heap_track_mark(void)
+{
+	return _heap.serial;
+}
+
+// Tags a long-lived allocation (tables, caches) so reports since a mark skip it.
+void heap_track_keep(void *buf)
+{
+	hnode_t *node = (hnode_t *)(buf - sizeof(hnode_t));
+
+	node->serial = 0;
+}
+
+// Groups live allocations made since a mark by caller, largest first.
+u32 heap_track_sites(heap_site_t *sites, u32 max, u32 since)
+{
+	u32 cnt = 0;
+
+	if (!max)
+		return 0;
+
+	for (hnode_t *node = _heap.first; node; node = node->next)
+	{
+		if (!node->used || node->serial < since)
+			continue;
+
+		u32 i;
+		for (i = 0; i < cnt; i++)
+			if (sites[i].tag == node->tag)
+				break;
+
+		// Account sites that do not fit to the last entry.
+		if (i == cnt)
+		{
+			if (cnt < max)
+			{
+				sites[i].tag = node->tag;
+				sites[i].count = 0;
+				sites[i].bytes = 0;
+				cnt++;
+			}
+			else
+			{
+				i = max - 1;
+				sites[i].tag = 0;
+			}
+		}
+
+		sites[i].count++;
+		sites[i].bytes += node->size + sizeof(hnode_t);
+	}
+
+	// Sort by bytes.
+	for (u32 i = 1; i < cnt; i++)
+	{
+		heap_site_t site = sites[i];
+		u32 j = i;
+		for (; j && sites[j - 1].bytes < site.bytes; j--)
+			sites[j] = sites[j - 1];
+		sites[j] = site;
+	}
+
+	return cnt;
+}
+#endif
@@ -20,20 +20,41 @@
 
 #include <utils/types.h>
 
+// Two level segregated fit. Second level splits each power of 2 in 16 classes.
+#if __SIZEOF_POINTER__ == 8
+#define HEAP_ALIGN_SHIFT 6 // sizeof(hnode_t). 64 bit host builds (tools/heaptest).
+#else
+#define HEAP_ALIGN_SHIFT 5 // sizeof(hnode_t).
+#endif
+#define HEAP_SL_SHIFT    4
+#define HEAP_SL_COUNT    (1 << HEAP_SL_SHIFT)
+#define HEAP_FL_SHIFT    (HEAP_SL_SHIFT + HEAP_ALIGN_SHIFT)
+#define HEAP_FL_COUNT    (32 - HEAP_FL_SHIFT + 1)
+
 typedef struct _hnode
 {
 	int used;
 	u32 size;
-	struct _hnode *prev;
+	struct _hnode *prev;      // Physically adjacent nodes.
 	struct _hnode *next;
-	u32 align[4]; // Align to arch cache line size.
-} hnode_t;
+	struct _hnode *free_prev; // Free list of the node's size class. Valid when unused.
+	struct _hnode *free_next;
+	u32 tag;    // Allocation site and order. Only set with BDK_MALLOC_TRACK.
+	u32 serial; // Also aligns to arch cache line size.
+} __attribute__((aligned(1 << HEAP_ALIGN_SHIFT))) hnode_t; // Pads 64 bit host builds.
 
 typedef struct _heap
 {
 	void *start;
 	hnode_t *first;
 	hnode_t *last;
+	u32 fl_bitmap;                // First level classes with free nodes.
+	u32 sl_bitmap[HEAP_FL_COUNT]; // Second level classes with free nodes.
+	hnode_t *free[HEAP_FL_COUNT][HEAP_SL_COUNT];
+	u32 used;   // Bytes in used nodes, headers included.
+	u32 peak;   // Highest used since init.
+	u32 allocs; // Live allocations.
+	u32 serial; // Next allocation serial.
 } heap_t;
 
 typedef struct
@@ -44,6 +65,23 @@ typedef struct
 	u32 nodes_used;
 } heap_monitor_t;
 
+typedef struct
+{
+	u32 used;         // Bytes in used nodes, headers included.
+	u32 peak;
+	u32 free;         // Bytes in free nodes below the heap top.
+	u32 largest_free; // Largest free node.
+	u32 frag;         // Free bytes outside the largest free node, per mille.
+	u32 allocs;
+} heap_stats_t;
+
+typedef struct
+{
+	u32 tag;   // Caller address, 0 for sites that did not fit.
+	u32 count; // Live allocations.
+	u32 bytes;
+} heap_site_t;
+
 void heap_init(void *base);
 void heap_set(heap_t *heap);
 void *malloc(u32 size);
@@ -51,5 +89,11 @@ void *calloc(u32 num, u32 size);
 void *zalloc(u32 size);
 void free(void *buf);
 void heap_monitor(heap_monitor_t *mon, bool print_node_stats);
+void heap_get_stats(heap_stats_t *stats);
+#ifdef BDK_MALLOC_TRACK
+u32  heap_track_mark(void);
+u32  heap_track_sites(heap_site_t *sites, u32 max, u32 since);
+void heap_track_keep(void *buf);
+#endif
 
 #endif
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2026
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "pool.h"
+
+void pool_init(pool_t *pool, void *base, u32 size, u32 obj_size)
+{
+	memset(pool, 0, sizeof(pool_t));
+
+	// Objects never share a cache line, so cache maintenance on one does not touch another.
+	u32 start = ALIGN((u32)base, POOL_ALIGN);
+	pool->base     = (u8 *)start;
+	pool->obj_size = ALIGN(obj_size, POOL_ALIGN);
+
+	if (size > start - (u32)base)
+		pool->count = (size - (start - (u32)base)) / pool->obj_size;
+}
+
+void *pool_alloc(pool_t *pool)
+{
+	void *obj;
+
+	// Reuse the most recently freed object first, it's the likeliest to be cached.
+	if (pool->free)
+	{
+		obj = pool->free;
+		pool->free = *(void **)obj;
+	}
+	else if (pool->carved < pool->count)
+	{
+		// Carve new objects lazily, so init does not touch the whole region.
+		obj = pool->base + pool->carved * pool->obj_size;
+		pool->carved++;
+	}
+	else
+		return NULL;
+
+	pool->used++;
+	if (pool->used > pool->peak)
+		pool->peak = pool->used;
+
+	return obj;
+}
+
+void pool_free(pool_t *pool, void *obj)
+{
+	if (!obj)
+		return;
+
+	*(void **)obj = pool->free;
+	pool->free = obj;
+	pool->used--;
+}
+
+bool pool_owns(pool_t *pool, void *obj)
+{
+	return (u8 *)obj >= pool->base && (u8 *)obj < pool->base + pool->carved * pool->obj_size;
+}
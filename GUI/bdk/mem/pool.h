@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2026
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#include <utils/types.h>
+
+#define POOL_ALIGN 64 // Largest arch cache line size. Keeps objects DMA safe.
+
+// Fixed size object pool over a reserved region.
+typedef struct _pool_t
+{
+	u8  *base;
+	u32  obj_size;
+	u32  count;    // Objects that fit in the region.
+	u32  carved;   // Objects handed out at least once.
+	u32  used;
+	u32  peak;
+	void *free;    // Freed objects, linked through their first word.
+} pool_t;
+
+void  pool_init(pool_t *pool, void *base, u32 size, u32 obj_size);
+void *pool_alloc(pool_t *pool);
+void  pool_free(pool_t *pool, void *obj);
+bool  pool_owns(pool_t *pool, void *obj);
+
+#endif
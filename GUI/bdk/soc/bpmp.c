@@ -113,10 +113,6 @@
 
 #define BPMP_MMU_SHADOW_ENTRY_BASE      (BPMP_CACHE_BASE + 0x400)
 #define BPMP_MMU_MAIN_ENTRY_BASE        (BPMP_CACHE_BASE + 0x800)
-#define  MMU_EN_CACHED                  BIT(0)
-#define  MMU_EN_EXEC                    BIT(1)
-#define  MMU_EN_READ                    BIT(2)
-#define  MMU_EN_WRITE                   BIT(3)
 
 static const bpmp_mmu_entry_t mmu_entries[] =
 {
@@ -35,6 +35,11 @@ typedef enum
 	BPMP_MMU_MAINT_CLN_INV_WAY        = 19
 } bpmp_maintenance_t;
 
+#define MMU_EN_CACHED BIT(0)
+#define MMU_EN_EXEC   BIT(1)
+#define MMU_EN_READ   BIT(2)
+#define MMU_EN_WRITE  BIT(3)
+
 typedef struct _bpmp_mmu_entry_t
 {
 	u32 start_addr;
@@ -24,6 +24,7 @@
 #include <mem/heap.h>
 #include <sec/se.h>
 #include <storage/emmc.h>
+#include <storage/nx_emmc_bis.h>
 #include <storage/sd.h>
 #include <storage/sdmmc.h>
 #include <utils/types.h>
@@ -32,20 +33,22 @@
 #define BIS_CLUSTER_SIZE      16384
 #define BIS_CACHE_MAX_ENTRIES 16384
 #define BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY -1
+#define BIS_WRITEBACK_BATCH   64
 
 typedef struct _cluster_cache_t
 {
 	u32  cluster_idx;            // Index of the cluster in the partition.
 	bool dirty;                  // Has been modified without write-back flag.
+	bool referenced;             // Accessed since the clock hand last passed.
 	u8   data[BIS_CLUSTER_SIZE]; // The cached cluster itself. Aligned to 8 bytes for DMA engine.
 } cluster_cache_t;
 
 typedef struct _bis_cache_t
 {
-	bool full;
 	bool enabled;
 	u32  dirty_cnt;
-	u32  top_idx;
+	u32  top_idx;    // Used entries. Entries are only recycled after all are used.
+	u32  clock_hand; // Next eviction candidate.
 	u8   dma_buff[BIS_CLUSTER_SIZE]; // Aligned to 8 bytes for DMA engine.
 	cluster_cache_t clusters[];
 } bis_cache_t;
@@ -56,6 +59,10 @@ static u32 emu_offset = 0;
 static emmc_part_t *system_part = NULL;
 static u32 *cache_lookup_tbl = (u32 *)NX_BIS_LOOKUP_ADDR;
 static bis_cache_t *bis_cache = (bis_cache_t *)NX_BIS_CACHE_ADDR;
+static nx_emmc_bis_stats_t bis_stats;
+static u32 cache_max_entries = BIS_CACHE_MAX_ENTRIES;
+static u32 cache_limit = BIS_CACHE_MAX_ENTRIES;
+static u32 cache_lookup_cnt = 0;
 
 static int nx_emmc_bis_write_block(u32 sector, u32 count, void *buff, bool flush)
 {
@@ -74,8 +81,11 @@ static int nx_emmc_bis_write_block(u32 sector, u32 count, void *buff, bool flush
 	if (is_cached)
 	{
 		if (buff)
+		{
 			memcpy(bis_cache->clusters[lookup_idx].data + sector_in_cluster * EMMC_BLOCKSIZE, buff, count * EMMC_BLOCKSIZE);
-		else
+			bis_cache->clusters[lookup_idx].referenced = true;
+		}
+		else // Writeback of the cached cluster. Not an access, so the clock hand can still evict it.
 			buff = bis_cache->clusters[lookup_idx].data;
 		if (!bis_cache->clusters[lookup_idx].dirty)
 			bis_cache->dirty_cnt++;
@@ -114,34 +124,122 @@ static int nx_emmc_bis_write_block(u32 sector, u32 count, void *buff, bool flush
 
 static void _nx_emmc_bis_cluster_cache_init(bool enable_cache)
 {
-	u32 cache_lookup_tbl_size = (system_part->lba_end - system_part->lba_start + 1) / BIS_CLUSTER_SECTORS * sizeof(*cache_lookup_tbl);
+	cache_lookup_cnt = (system_part->lba_end - system_part->lba_start + 1) / BIS_CLUSTER_SECTORS;
 
 	// Clear cache header.
 	memset(bis_cache, 0, sizeof(bis_cache_t));
+	cache_max_entries = cache_limit;
 
 	// Clear cluster lookup table.
-	memset(cache_lookup_tbl, BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY, cache_lookup_tbl_size);
+	memset(cache_lookup_tbl, BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY, cache_lookup_cnt * sizeof(*cache_lookup_tbl));
 
 	// Enable cache.
 	bis_cache->enabled = enable_cache;
 }
 
+static int _nx_emmc_bis_writeback(u32 idx)
+{
+	cluster_cache_t *entry = &bis_cache->clusters[idx];
+
+	// Write block also clears the dirty flag and count on success.
+	if (nx_emmc_bis_write_block(entry->cluster_idx * BIS_CLUSTER_SECTORS, BIS_CLUSTER_SECTORS, NULL, true))
+		return 0;
+
+	bis_stats.writebacks++;
+
+	return 1;
+}
+
 static void _nx_emmc_bis_flush_cache()
 {
 	if (!bis_cache->enabled || !bis_cache->dirty_cnt)
 		return;
 
-	for (u32 i = 0; i < bis_cache->top_idx && bis_cache->dirty_cnt; i++)
+	// The lookup table is indexed by cluster, so walking it writes back in LBA order.
+	for (u32 cluster = 0; cluster < cache_lookup_cnt && bis_cache->dirty_cnt; cluster++)
 	{
-		if (bis_cache->clusters[i].dirty) {
-			nx_emmc_bis_write_block(bis_cache->clusters[i].cluster_idx * BIS_CLUSTER_SECTORS, BIS_CLUSTER_SECTORS, NULL, true);
-			bis_cache->dirty_cnt--;
-		}
+		u32 idx = cache_lookup_tbl[cluster];
+		if (idx != (u32)BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY && bis_cache->clusters[idx].dirty)
+			_nx_emmc_bis_writeback(idx);
 	}
 
 	_nx_emmc_bis_cluster_cache_init(true);
 }
 
+/*
+ * Writes back up to BIS_WRITEBACK_BATCH dirty clusters, starting at the clock hand.
+ * The batch is sorted by cluster so the device sees ascending LBAs.
+ */
+static int _nx_emmc_bis_writeback_batch()
+{
+	u32 batch[BIS_WRITEBACK_BATCH];
+	u32 cnt = 0;
+
+	for (u32 i = 0; i < cache_max_entries && cnt < BIS_WRITEBACK_BATCH; i++)
+	{
+		u32 idx = (bis_cache->clock_hand + i) % cache_max_entries;
+		if (!bis_cache->clusters[idx].dirty)
+			continue;
+
+		// Insertion sort by cluster index.
+		u32 pos = cnt++;
+		while (pos && bis_cache->clusters[batch[pos - 1]].cluster_idx > bis_cache->clusters[idx].cluster_idx)
+		{
+			batch[pos] = batch[pos - 1];
+			pos--;
+		}
+		batch[pos] = idx;
+	}
+
+	int res = 0;
+	for (u32 i = 0; i < cnt; i++)
+		res |= _nx_emmc_bis_writeback(batch[i]);
+
+	return res;
+}
+
+/*
+ * CLOCK replacement. Referenced entries get a second chance and clean entries are
+ * preferred over dirty ones. If only dirty entries are left, a sorted batch of them
+ * is written back first. Returns the freed entry or -1 on write-back failure.
+ */
+static int _nx_emmc_bis_cache_evict()
+{
+	for (u32 pass = 0; pass < 2; pass++)
+	{
+		// Two revolutions: the first one may only clear reference bits.
+		for (u32 i = 0; i < cache_max_entries * 2; i++)
+		{
+			u32 idx = bis_cache->clock_hand;
+			cluster_cache_t *entry = &bis_cache->clusters[idx];
+
+			bis_cache->clock_hand = (idx + 1) % cache_max_entries;
+
+			if (entry->referenced)
+				entry->referenced = false;
+			else if (!entry->dirty)
+			{
+				cache_lookup_tbl[entry->cluster_idx] = BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY;
+				bis_stats.evictions++;
+
+				return idx;
+			}
+		}
+
+		// Everything left is dirty.
+		if (!_nx_emmc_bis_writeback_batch())
+			break;
+	}
+
+	return -1;
+}
+
+// Bounds the cache to fewer clusters. Applies on the next nx_emmc_bis_init().
+void nx_emmc_bis_set_cache_limit(u32 entries)
+{
+	cache_limit = MIN(MAX(entries, BIS_WRITEBACK_BATCH), BIS_CACHE_MAX_ENTRIES);
+}
+
 static int nx_emmc_bis_read_block_normal(u32 sector, u32 count, void *buff)
 {
 	static u32 prev_cluster = -1;
@@ -198,18 +296,13 @@ static int nx_emmc_bis_read_block_cached(u32 sector, u32 count, void *buff)
 	if (lookup_idx != (u32)BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY)
 	{
 		memcpy(buff, bis_cache->clusters[lookup_idx].data + sector_in_cluster * EMMC_BLOCKSIZE, count * EMMC_BLOCKSIZE);
+		bis_cache->clusters[lookup_idx].referenced = true;
+		bis_stats.hits++;
 
 		return 0; // Success.
 	}
 
-	// Flush cache if full.
-	if (bis_cache->top_idx >= BIS_CACHE_MAX_ENTRIES)
-		_nx_emmc_bis_flush_cache();
-
-	// Set new cached cluster parameters.
-	bis_cache->clusters[bis_cache->top_idx].cluster_idx = cluster;
-	bis_cache->clusters[bis_cache->top_idx].dirty = false;
-	cache_lookup_tbl[cluster] = bis_cache->top_idx;
+	bis_stats.misses++;
 
 	// Read the whole cluster the sector resides in.
 	if (!emu_offset)
@@ -223,12 +316,27 @@ static int nx_emmc_bis_read_block_cached(u32 sector, u32 count, void *buff)
 	if (!se_aes_xts_crypt_sec_nx(ks_tweak, ks_crypt, DECRYPT, cluster, cache_tweak, true, 0, bis_cache->dma_buff, bis_cache->dma_buff, BIS_CLUSTER_SIZE))
 		return 1; // Decryption error.
 
-	// Copy to cluster cache.
-	memcpy(bis_cache->clusters[bis_cache->top_idx].data, bis_cache->dma_buff, BIS_CLUSTER_SIZE);
 	memcpy(buff, bis_cache->dma_buff + sector_in_cluster * EMMC_BLOCKSIZE, count * EMMC_BLOCKSIZE);
 
-	// Increment cache count.
-	bis_cache->top_idx++;
+	// Get a free entry or recycle one.
+	int idx;
+	if (bis_cache->top_idx < cache_max_entries)
+		idx = bis_cache->top_idx++;
+	else
+	{
+		idx = _nx_emmc_bis_cache_evict();
+		if (idx < 0)
+			return 0; // Data is valid, only caching failed.
+	}
+
+	// Set new cached cluster parameters.
+	bis_cache->clusters[idx].cluster_idx = cluster;
+	bis_cache->clusters[idx].dirty = false;
+	bis_cache->clusters[idx].referenced = false;
+	cache_lookup_tbl[cluster] = idx;
+
+	// Copy to cluster cache.
+	memcpy(bis_cache->clusters[idx].data, bis_cache->dma_buff, BIS_CLUSTER_SIZE);
 
 	return 0; // Success.
 }
@@ -298,6 +406,7 @@ void nx_emmc_bis_init(emmc_part_t *part, bool enable_cache, u32 emummc_offset)
 	emu_offset = emummc_offset;
 
 	_nx_emmc_bis_cluster_cache_init(enable_cache);
+	memset(&bis_stats, 0, sizeof(nx_emmc_bis_stats_t));
 
 	if (!strcmp(part->name, "PRODINFO") || !strcmp(part->name, "PRODINFOF"))
 	{
@@ -323,3 +432,8 @@ void nx_emmc_bis_end()
 	_nx_emmc_bis_flush_cache();
 	system_part = NULL;
 }
+
+void nx_emmc_bis_get_stats(nx_emmc_bis_stats_t *stats)
+{
+	memcpy(stats, &bis_stats, sizeof(nx_emmc_bis_stats_t));
+}
@@ -235,9 +235,19 @@ typedef struct _nx_emmc_cal0_t
 	u8   crc16_pad61[0xF];
 } __attribute__((packed)) nx_emmc_cal0_t;
 
+typedef struct _nx_emmc_bis_stats_t
+{
+	u32 hits;       // Reads served from the cluster cache.
+	u32 misses;     // Reads that fetched and decrypted a cluster.
+	u32 evictions;  // Clusters dropped to make room.
+	u32 writebacks; // Dirty clusters written back on eviction.
+} nx_emmc_bis_stats_t;
+
 int  nx_emmc_bis_read(u32 sector, u32 count, void *buff);
 int  nx_emmc_bis_write(u32 sector, u32 count, void *buff);
 void nx_emmc_bis_init(emmc_part_t *part, bool enable_cache, u32 emummc_offset);
 void nx_emmc_bis_end();
+void nx_emmc_bis_get_stats(nx_emmc_bis_stats_t *stats);
+void nx_emmc_bis_set_cache_limit(u32 entries);
 
 #endif
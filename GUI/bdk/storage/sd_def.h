@@ -24,6 +24,13 @@
 /* class 5 */
 #define SD_ERASE_WR_BLK_START    32 /* ac   [31:0] data addr   R1  */
 #define SD_ERASE_WR_BLK_END      33 /* ac   [31:0] data addr   R1  */
+#define SD_ERASE                 38 /* ac   [31:0] See below   R1b */
+/* class 1 */
+#define SD_Q_MANAGEMENT          43 /* ac   [20:16] task id    R1b */
+#define SD_Q_TASK_INFO_A         44 /* ac   [31:0] See below   R1  */
+#define SD_Q_TASK_INFO_B         45 /* ac   [31:0] data addr   R1  */
+#define SD_Q_RD_TASK             46 /* adtc [20:16] task id    R1  */
+#define SD_Q_WR_TASK             47 /* adtc [20:16] task id    R1  */
  /* class 11 */
 #define SD_READ_EXTR_SINGLE      48 /* adtc [31:0]             R1  */
 #define SD_WRITE_EXTR_SINGLE     49 /* adtc [31:0]             R1  */
@@ -88,6 +95,45 @@
  *	[15:0] Block offset
  */
 
+/*
+ * SD_ERASE argument
+ */
+#define SD_ERASE_ARG		0 /* Erase. Data becomes all 0s or 1s */
+#define SD_DISCARD_ARG		1 /* Discard. Data content is undefined */
+#define SD_FULE_ARG		2 /* Full User Area Logical Erase */
+
+/*
+ * SD_Q_TASK_INFO_A argument format:
+ *
+ *	[31] Reserved (0)
+ *	[30] Direction. Read (1) or write (0)
+ *	[29:24] Reserved (0)
+ *	[23] Priority
+ *	[22:21] Reserved (0)
+ *	[20:16] Task ID
+ *	[15:0] Number of blocks
+ */
+#define SD_QTASK_DIR_READ	(1U << 30)
+#define SD_QTASK_ID(id)		((id) << 16)
+
+/*
+ * SD_Q_MANAGEMENT operations
+ */
+#define SD_QMGMT_ABORT_QUEUE	1
+#define SD_QMGMT_ABORT_TASK	2
+
+/*
+ * SEND_STATUS argument bit to get the Queue Status Register (task ready mask)
+ */
+#define SD_SEND_TASK_STATUS	(1U << 15)
+
+/*
+ * Performance Enhancement extension register offsets
+ */
+#define SD_EXT_PERF_CACHE_EN	260
+#define SD_EXT_PERF_CACHE_FLUSH	261
+#define SD_EXT_PERF_CMDQ_EN	262
+
 /*
  * SCR field definitions
  */
@@ -306,8 +306,8 @@ static int _sdmmc_storage_readwrite(sdmmc_storage_t *storage, u32 sector, u32 nu
 	u32 sct_total = num_sectors;
 	bool first_reinit = true;
 
-	// Exit if not initialized.
-	if (!storage->initialized)
+	// Exit if not initialized or if legacy commands are illegal.
+	if (!storage->initialized || storage->ser.cmdq_en)
 		return 0;
 
 	// Check if out of bounds.
@@ -364,6 +364,90 @@ out:
 	return 1;
 }
 
+/*
+ * Single read attempt without retries or reinit on failure.
+ * Buffer must be SDMMC DMA accessible. Used for signal integrity diagnostics.
+ */
+int sdmmc_storage_read_once(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf)
+{
+	u32 blkcnt = 0;
+
+	if (!storage->initialized || storage->ser.cmdq_en || num_sectors > 0xFFFF)
+		return 0;
+
+	if (((u64)sector + num_sectors) > storage->sec_cnt)
+		return 0;
+
+	if (!_sdmmc_storage_readwrite_ex(storage, &blkcnt, sector, num_sectors, buf, 0))
+		return 0;
+
+	return blkcnt == num_sectors;
+}
+
+/*
+ * Non-blocking read. Starts the transfer and returns after the command response.
+ * sdmmc_storage_async_poll() must be called until it stops returning SDMMC_ASYNC_BUSY.
+ * No retries or reinit on failure. Buffer must be SDMMC DMA accessible.
+ */
+int sdmmc_storage_read_async(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf)
+{
+	u32 tmp = 0;
+	sdmmc_cmd_t cmdbuf;
+	sdmmc_req_t reqbuf;
+
+	if (!storage->initialized || storage->ser.cmdq_en || num_sectors > 0xFFFF)
+		return 0;
+
+	if (((u64)sector + num_sectors) > storage->sec_cnt)
+		return 0;
+
+	// If SDSC convert block address to byte address.
+	if (!storage->has_sector_access)
+		sector <<= 9;
+
+	sdmmc_init_cmd(&cmdbuf, MMC_READ_MULTIPLE_BLOCK, sector, SDMMC_RSP_TYPE_1, 0);
+
+	reqbuf.buf              = buf;
+	reqbuf.num_sectors      = num_sectors;
+	reqbuf.blksize          = SDMMC_DAT_BLOCKSIZE;
+	reqbuf.is_write         = 0;
+	reqbuf.is_multi_block   = 1;
+	reqbuf.is_auto_stop_trn = 1;
+
+	if (!sdmmc_execute_cmd_async(storage->sdmmc, &cmdbuf, &reqbuf))
+	{
+		sdmmc_stop_transmission(storage->sdmmc, &tmp);
+		_sdmmc_storage_get_status(storage, &tmp, 0);
+
+		return 0;
+	}
+
+	return 1;
+}
+
+int sdmmc_storage_async_poll(sdmmc_storage_t *storage, u32 *blkcnt_out)
+{
+	u32 tmp = 0;
+
+	int res = sdmmc_poll_cmd_async(storage->sdmmc, blkcnt_out);
+	if (res == SDMMC_ASYNC_BUSY)
+		return res;
+
+	if (res == SDMMC_ASYNC_ERROR)
+	{
+		sdmmc_stop_transmission(storage->sdmmc, &tmp);
+		_sdmmc_storage_get_status(storage, &tmp, 0);
+
+		return res;
+	}
+
+	sdmmc_get_cached_rsp(storage->sdmmc, &tmp, SDMMC_RSP_TYPE_1);
+	if (!_sdmmc_storage_check_card_status(tmp))
+		return SDMMC_ASYNC_ERROR;
+
+	return SDMMC_ASYNC_DONE;
+}
+
 int sdmmc_storage_read(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf)
 {
 	// Ensure that SDMMC has access to buffer and it's SDMMC DMA aligned.
@@ -595,6 +679,37 @@ int sd_storage_get_ext_reg(sdmmc_storage_t *storage, u8 fno, u8 page, u16 addres
 	return _sdmmc_storage_check_card_status(tmp);
 }
 
+int sd_storage_set_ext_reg(sdmmc_storage_t *storage, u8 fno, u8 page, u16 address, u32 len, void *buf)
+{
+	if (!(storage->scr.cmds & BIT(2)))
+		return 0;
+
+	sdmmc_cmd_t cmdbuf;
+
+	u32 arg = fno << 27 | page << 18 | address << 9 | (len - 1);
+
+	sdmmc_init_cmd(&cmdbuf, SD_WRITE_EXTR_SINGLE, arg, SDMMC_RSP_TYPE_1, 0);
+
+	sdmmc_req_t reqbuf;
+	reqbuf.buf = buf;
+	reqbuf.blksize = SDMMC_DAT_BLOCKSIZE;
+	reqbuf.num_sectors = 1;
+	reqbuf.is_write = 1;
+	reqbuf.is_multi_block = 0;
+	reqbuf.is_auto_stop_trn = 0;
+
+	if (!sdmmc_execute_cmd(storage->sdmmc, &cmdbuf, &reqbuf, NULL))
+		return 0;
+
+	u32 tmp = 0;
+	sdmmc_get_cached_rsp(storage->sdmmc, &tmp, SDMMC_RSP_TYPE_1);
+	if (!_sdmmc_storage_check_card_status(tmp))
+		return 0;
+
+	// Card is busy while it applies the new register value.
+	return _sdmmc_storage_check_status(storage);
+}
+
 static int _mmc_storage_switch(sdmmc_storage_t *storage, u32 arg)
 {
 	return _sdmmc_storage_execute_cmd_type1(storage, MMC_SWITCH, arg, 1, R1_SKIP_STATE_CHECK);
@@ -1060,6 +1175,7 @@ static int _sd_storage_get_op_cond(sdmmc_storage_t *storage, bool is_sdsc, int b
 		}
 		if (get_tmr_ms() > timeout)
 			break;
+		storage->init_prof.retries[SD_INIT_STEP_OP_COND]++;
 		msleep(10); // Needs to be at least 10ms for some SD Cards
 	}
 
@@ -1090,6 +1206,7 @@ static int _sd_storage_get_rca(sdmmc_storage_t *storage)
 
 		if (get_tmr_ms() > timeout)
 			break;
+		storage->init_prof.retries[SD_INIT_STEP_RCA]++;
 		usleep(1000);
 	}
 
@@ -1199,7 +1316,7 @@ static int _sd_storage_switch(sdmmc_storage_t *storage, void *buf, int mode, int
 	return _sdmmc_storage_check_card_status(tmp);
 }
 
-static void _sd_storage_set_power_limit(sdmmc_storage_t *storage, u16 power_limit, u8 *buf)
+static u32 _sd_storage_set_power_limit(sdmmc_storage_t *storage, u16 power_limit, u8 *buf)
 {
 	u32 pwr = SD_SET_POWER_LIMIT_0_72;
 
@@ -1235,6 +1352,8 @@ static void _sd_storage_set_power_limit(sdmmc_storage_t *storage, u16 power_limi
 		DPRINTF("[SD] power limit defaulted to 720 mW\n");
 		break;
 	}
+
+	return (buf[15] >> 4) & 0x0F;
 }
 
 int _sd_storage_set_driver_type(sdmmc_storage_t *storage, u32 driver, u8 *buf)
@@ -1326,8 +1445,11 @@ static int _sd_storage_enable_DDR200(sdmmc_storage_t *storage, u8 *buf)
 			return 0;
 		DPRINTF("[SD] after setup clock DDR200\n");
 
+		u32 tuning_us = get_tmr_us();
 		if (!sdmmc_tuning_execute(storage->sdmmc, SDHCI_TIMING_UHS_DDR200, MMC_SEND_TUNING_BLOCK))
 			return 0;
+		storage->init_prof.time_us[SD_INIT_STEP_TUNING] += get_tmr_us() - tuning_us;
+		storage->init_prof.tuning_cmds += storage->sdmmc->tuning_cmds;
 		DPRINTF("[SD] after tuning DDR200\n");
 
 		return _sdmmc_storage_check_status(storage);
@@ -1379,6 +1501,134 @@ int sd_storage_get_fmodes(sdmmc_storage_t *storage, u8 *buf, sd_func_modes_t *fm
 	fmodes->cmd_system      = buf[11] | (buf[10] << 8);
 	fmodes->driver_strength = buf[9]  | (buf[8]  << 8);
 	fmodes->power_limit     = buf[7]  | (buf[6]  << 8);
+	fmodes->cur_driver_type = buf[15] & 0xF;
+	fmodes->cur_power_limit = (buf[15] >> 4) & 0xF;
+
+	return 1;
+}
+
+/*
+ * SD bus config cache
+ *
+ * Tuning and function negotiation results of SDR104/SDR50 cards are kept per
+ * CID. On next init of the same card, the cached mode, driver type and power
+ * limit are set directly and the tuned tap is restored without tuning.
+ * A read verifies the result and full negotiation is done on failure.
+ */
+static sd_bus_cfg_t _sd_bus_cfg[SD_BUS_CFG_MAX];
+static u32  _sd_bus_cfg_cnt   = 0;
+static bool _sd_bus_cfg_dirty = false;
+
+static sd_bus_cfg_t *_sd_storage_find_bus_cfg(const u8 *raw_cid, u32 type)
+{
+	for (u32 i = 0; i < _sd_bus_cfg_cnt; i++)
+		if (_sd_bus_cfg[i].type == type && !memcmp(_sd_bus_cfg[i].raw_cid, raw_cid, 0x10))
+			return &_sd_bus_cfg[i];
+
+	return NULL;
+}
+
+static void _sd_storage_remove_bus_cfg(sd_bus_cfg_t *cfg)
+{
+	u32 idx = cfg - _sd_bus_cfg;
+
+	memmove(cfg, cfg + 1, (_sd_bus_cfg_cnt - idx - 1) * sizeof(sd_bus_cfg_t));
+	_sd_bus_cfg_cnt--;
+	_sd_bus_cfg_dirty = true;
+}
+
+static void _sd_storage_save_bus_cfg(sdmmc_storage_t *storage, u32 type, u32 timing, u32 drv_type, u32 pwr_limit)
+{
+	sd_bus_cfg_t cfg = { 0 };
+
+	memcpy(cfg.raw_cid, storage->raw_cid, 0x10);
+	cfg.type      = type;
+	cfg.timing    = timing;
+	cfg.tap       = sdmmc_get_tap(storage->sdmmc);
+	cfg.drv_type  = drv_type;
+	cfg.pwr_limit = pwr_limit;
+
+	sd_bus_cfg_t *old = _sd_storage_find_bus_cfg(storage->raw_cid, type);
+	if (old)
+	{
+		if (!memcmp(old, &cfg, sizeof(sd_bus_cfg_t)))
+			return;
+
+		_sd_storage_remove_bus_cfg(old);
+	}
+
+	// Drop the oldest entry if full.
+	if (_sd_bus_cfg_cnt == SD_BUS_CFG_MAX)
+		_sd_storage_remove_bus_cfg(&_sd_bus_cfg[0]);
+
+	memcpy(&_sd_bus_cfg[_sd_bus_cfg_cnt++], &cfg, sizeof(sd_bus_cfg_t));
+	_sd_bus_cfg_dirty = true;
+}
+
+// Merges persisted entries. Entries already in memory are newer and kept.
+void sd_storage_bus_cfg_import(const sd_bus_cfg_t *cfgs, u32 count)
+{
+	for (u32 i = 0; i < count && _sd_bus_cfg_cnt < SD_BUS_CFG_MAX; i++)
+	{
+		if (_sd_storage_find_bus_cfg(cfgs[i].raw_cid, cfgs[i].type))
+		{
+			_sd_bus_cfg_dirty = true;
+			continue;
+		}
+
+		memcpy(&_sd_bus_cfg[_sd_bus_cfg_cnt++], &cfgs[i], sizeof(sd_bus_cfg_t));
+	}
+}
+
+u32 sd_storage_bus_cfg_export(sd_bus_cfg_t **cfgs)
+{
+	*cfgs = _sd_bus_cfg;
+	_sd_bus_cfg_dirty = false;
+
+	return _sd_bus_cfg_cnt;
+}
+
+bool sd_storage_bus_cfg_dirty(void)
+{
+	return _sd_bus_cfg_dirty;
+}
+
+static int _sd_storage_enable_uhs_cached(sdmmc_storage_t *storage, sd_bus_cfg_t *cfg, u8 *buf)
+{
+	u32 hs_type = cfg->timing == SDHCI_TIMING_UHS_SDR104 ? UHS_SDR104_BUS_SPEED : UHS_SDR50_BUS_SPEED;
+	u32 blkcnt = 0;
+
+	if (cfg->drv_type != SD_SET_DRIVER_TYPE_B && !_sd_storage_set_driver_type(storage, cfg->drv_type, buf))
+		return 0;
+
+	if (!_sd_storage_switch(storage, buf, SD_SWITCH_SET, SD_SWITCH_GRP_PWRLIM, cfg->pwr_limit))
+		return 0;
+
+	if (!_sd_storage_switch(storage, buf, SD_SWITCH_SET, SD_SWITCH_GRP_ACCESS, hs_type))
+		return 0;
+
+	if ((buf[16] & 0xF) != hs_type)
+		return 0;
+	storage->max_power = ((u16)buf[0] << 8) | buf[1];
+
+	if (!sdmmc_setup_clock(storage->sdmmc, cfg->timing))
+		return 0;
+
+	// Restore tuned tap instead of tuning.
+	u32 tuning_us = get_tmr_us();
+	sdmmc_set_tap(storage->sdmmc, cfg->tap);
+
+	if (!_sdmmc_storage_check_status(storage))
+		return 0;
+
+	// Verify that data can be sampled reliably.
+	if (!_sdmmc_storage_readwrite_ex(storage, &blkcnt, 0, 1, buf, 0) || blkcnt != 1)
+		return 0;
+	storage->init_prof.time_us[SD_INIT_STEP_TUNING] += get_tmr_us() - tuning_us;
+
+	DPRINTF("[SD] restored cached bus config\n");
+	storage->csd.busspeed = cfg->timing == SDHCI_TIMING_UHS_SDR104 ? 104 : 50;
+	storage->bus_cfg_cached = 1;
 
 	return 1;
 }
@@ -1386,10 +1636,26 @@ int sd_storage_get_fmodes(sdmmc_storage_t *storage, u8 *buf, sd_func_modes_t *fm
 static int _sd_storage_enable_uhs_low_volt(sdmmc_storage_t *storage, u32 type, u8 *buf)
 {
 	sd_func_modes_t fmodes;
+	u32 req_type = type;
+	u32 pwr_limit = SD_SET_POWER_LIMIT_0_72;
 
 	if (sdmmc_get_bus_width(storage->sdmmc) != SDMMC_BUS_WIDTH_4)
 		return 0;
 
+	sd_bus_cfg_t *cfg = _sd_storage_find_bus_cfg(storage->raw_cid, type);
+	if (cfg)
+	{
+		if (_sd_storage_enable_uhs_cached(storage, cfg, buf))
+			return 1;
+
+		// Stale entry. Go back to a safe clock and negotiate again.
+		DPRINTF("[SD] cached bus config failed\n");
+		storage->init_prof.retries[SD_INIT_STEP_TUNING]++;
+		_sd_storage_remove_bus_cfg(cfg);
+		if (!sdmmc_setup_clock(storage->sdmmc, SDHCI_TIMING_UHS_SDR12))
+			return 0;
+	}
+
 	if (!sd_storage_get_fmodes(storage, buf, &fmodes))
 		return 0;
 
@@ -1472,7 +1738,7 @@ static int _sd_storage_enable_uhs_low_volt(sdmmc_storage_t *storage, u32 type, u
 
 	// Try to raise the power limit to let the card perform better.
 	if (hs_type != UHS_SDR25_BUS_SPEED) // Not applicable for SDR12/SDR25.
-		_sd_storage_set_power_limit(storage, fmodes.power_limit, buf);
+		pwr_limit = _sd_storage_set_power_limit(storage, fmodes.power_limit, buf);
 
 	// Setup and set selected card and bus speed.
 	if (!_sd_storage_set_card_bus_speed(storage, hs_type, buf))
@@ -1483,10 +1749,142 @@ static int _sd_storage_enable_uhs_low_volt(sdmmc_storage_t *storage, u32 type, u
 		return 0;
 	DPRINTF("[SD] after setup clock\n");
 
+	u32 tuning_us = get_tmr_us();
 	if (!sdmmc_tuning_execute(storage->sdmmc, type, MMC_SEND_TUNING_BLOCK))
 		return 0;
+	storage->init_prof.time_us[SD_INIT_STEP_TUNING] += get_tmr_us() - tuning_us;
+	storage->init_prof.tuning_cmds += storage->sdmmc->tuning_cmds;
 	DPRINTF("[SD] after tuning\n");
 
+	if (!_sdmmc_storage_check_status(storage))
+		return 0;
+
+	if (type == SDHCI_TIMING_UHS_SDR104 || type == SDHCI_TIMING_UHS_SDR50)
+		_sd_storage_save_bus_cfg(storage, req_type, type, SD_SET_DRIVER_TYPE_B, pwr_limit);
+
+	return 1;
+}
+
+static u32 _sd_storage_get_uhs_timing(sdmmc_storage_t *storage)
+{
+	switch (storage->csd.busspeed)
+	{
+	case 104:
+		return SDHCI_TIMING_UHS_SDR104;
+	case 50:
+		return SDHCI_TIMING_UHS_SDR50;
+	default:
+		return 0; // Not a tuned mode that can be cached.
+	}
+}
+
+// Stores the current driver type, power limit and tap to the card's cached bus configs.
+int sd_storage_bus_cfg_store(sdmmc_storage_t *storage)
+{
+	sd_func_modes_t fmodes;
+	u32 timing = _sd_storage_get_uhs_timing(storage);
+
+	if (!storage->initialized || !timing)
+		return 0;
+
+	if (!sd_storage_get_fmodes(storage, NULL, &fmodes))
+		return 0;
+
+	u32 stored = 0;
+	for (u32 i = 0; i < _sd_bus_cfg_cnt; i++)
+	{
+		sd_bus_cfg_t *cfg = &_sd_bus_cfg[i];
+		if (cfg->timing != timing || memcmp(cfg->raw_cid, storage->raw_cid, 0x10))
+			continue;
+
+		cfg->tap       = sdmmc_get_tap(storage->sdmmc);
+		cfg->drv_type  = fmodes.cur_driver_type;
+		cfg->pwr_limit = fmodes.cur_power_limit;
+		stored++;
+	}
+
+	// Not cached yet. Add it for the requested timing.
+	if (!stored)
+		_sd_storage_save_bus_cfg(storage, timing, timing, fmodes.cur_driver_type, fmodes.cur_power_limit);
+
+	_sd_bus_cfg_dirty = true;
+
+	return 1;
+}
+
+/*
+ * Applies the cached driver type and power limit to a card that was set up
+ * before its entry was imported. Only needed if init negotiated other ones.
+ */
+int sd_storage_bus_cfg_apply(sdmmc_storage_t *storage)
+{
+	sd_func_modes_t fmodes;
+	u32 timing = _sd_storage_get_uhs_timing(storage);
+
+	if (!storage->initialized || storage->bus_cfg_cached || !timing)
+		return 0;
+
+	for (u32 i = 0; i < _sd_bus_cfg_cnt; i++)
+	{
+		sd_bus_cfg_t *cfg = &_sd_bus_cfg[i];
+		if (cfg->timing != timing || memcmp(cfg->raw_cid, storage->raw_cid, 0x10))
+			continue;
+
+		if (!sd_storage_get_fmodes(storage, NULL, &fmodes))
+			return 0;
+
+		if (cfg->drv_type == fmodes.cur_driver_type && cfg->pwr_limit == fmodes.cur_power_limit)
+			return 0;
+
+		if (sd_storage_set_bus_drive(storage, cfg->drv_type, cfg->pwr_limit))
+			return 1;
+
+		// Stale entry. Go back to what init negotiated.
+		_sd_storage_remove_bus_cfg(cfg);
+		sd_storage_set_bus_drive(storage, fmodes.cur_driver_type, fmodes.cur_power_limit);
+
+		return 0;
+	}
+
+	return 0;
+}
+
+// Driver type and power limit can only be changed in SDR104/SDR50, the modes that can be re-tuned and cached.
+bool sd_storage_bus_drive_supported(sdmmc_storage_t *storage)
+{
+	return storage->initialized && !storage->ser.cmdq_en && _sd_storage_get_uhs_timing(storage);
+}
+
+/*
+ * Changes card driver type and power limit on an initialized UHS card.
+ * Output timing changes with the driver type, so the bus is tuned again.
+ * Power limit is capped at 1.44W like init, since the SD rail is only rated for UHS-I.
+ */
+int sd_storage_set_bus_drive(sdmmc_storage_t *storage, u32 drv_type, u32 pwr_limit)
+{
+	u8 *buf = (u8 *)SDMMC_UPPER_BUFFER;
+	u32 timing = _sd_storage_get_uhs_timing(storage);
+
+	if (!sd_storage_bus_drive_supported(storage) || pwr_limit > SD_SET_POWER_LIMIT_1_44)
+		return 0;
+
+	if (!_sd_storage_set_driver_type(storage, drv_type, buf))
+		return 0;
+
+	if (!_sd_storage_switch(storage, buf, SD_SWITCH_SET, SD_SWITCH_GRP_PWRLIM, pwr_limit))
+		return 0;
+
+	if (((buf[15] >> 4) & 0xF) != pwr_limit)
+		return 0;
+
+	// Tuning is not allowed with card clock power saving.
+	sdmmc_card_clock_powersave(storage->sdmmc, SDMMC_POWER_SAVE_DISABLE);
+	int res = sdmmc_tuning_execute(storage->sdmmc, timing, MMC_SEND_TUNING_BLOCK);
+	sdmmc_card_clock_powersave(storage->sdmmc, SDMMC_POWER_SAVE_ENABLE);
+
+	if (!res)
+		return 0;
+
 	return _sdmmc_storage_check_status(storage);
 }
 
@@ -1591,6 +1989,95 @@ static void _sd_storage_parse_ssr(sdmmc_storage_t *storage)
 	storage->ssr.uhs_au_size = unstuff_bits(raw_ssr1, 392, 4);
 
 	storage->ssr.perf_enhance = unstuff_bits(raw_ssr2, 328, 8);
+
+	storage->ssr.erase_size    = unstuff_bits(raw_ssr1, 408, 16);
+	storage->ssr.erase_timeout = unstuff_bits(raw_ssr1, 402, 6);
+	storage->ssr.erase_offset  = unstuff_bits(raw_ssr1, 400, 2);
+	storage->ssr.discard       = unstuff_bits(raw_ssr2, 313, 1);
+	storage->ssr.fule          = unstuff_bits(raw_ssr2, 312, 1);
+}
+
+static u32 _sd_storage_erase_timeout(sdmmc_storage_t *storage, u32 num_sectors, u32 arg)
+{
+	u32 timeout_ms;
+
+	// Discard only updates mapping tables. Use a fixed timeout.
+	if (arg == SD_DISCARD_ARG)
+		return 250;
+
+	u32 au_sectors = sd_storage_get_ssr_au(storage) * 2;
+	if (!au_sectors)
+		au_sectors = SZ_4M / 512;
+	u32 num_au = (num_sectors + au_sectors - 1) / au_sectors;
+
+	if (storage->ssr.erase_timeout && storage->ssr.erase_size)
+	{
+		// Timeout = T_ERASE / N_ERASE * AUs + T_OFFSET.
+		// Multiply first, the per AU share is not a whole number of ms.
+		timeout_ms = (u64)storage->ssr.erase_timeout * 1000 * num_au / storage->ssr.erase_size +
+					 storage->ssr.erase_offset * 1000;
+	}
+	else
+		timeout_ms = 250 * num_au; // Not specified. Use 250ms per AU.
+
+	// Must not be less than 1s.
+	return MAX(timeout_ms, 1000);
+}
+
+int sd_storage_erase(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, u32 arg)
+{
+	u32 resp;
+
+	if (!storage->initialized || storage->ser.cmdq_en || !num_sectors)
+		return 0;
+
+	if (!(storage->csd.cmdclass & CCC_ERASE))
+		return 0;
+
+	if ((arg == SD_DISCARD_ARG && !storage->ssr.discard) || (arg == SD_FULE_ARG && !storage->ssr.fule))
+		return 0;
+
+	// Check if out of bounds.
+	if (((u64)sector + num_sectors) > storage->sec_cnt)
+		return 0;
+
+	u32 start = sector;
+	u32 end   = sector + num_sectors - 1;
+
+	// If SDSC convert block address to byte address.
+	if (!storage->has_sector_access)
+	{
+		start <<= 9;
+		end   <<= 9;
+	}
+
+	if (!_sdmmc_storage_execute_cmd_type1(storage, SD_ERASE_WR_BLK_START, start, 0, R1_STATE_TRAN))
+		return 0;
+
+	if (!_sdmmc_storage_execute_cmd_type1(storage, SD_ERASE_WR_BLK_END, end, 0, R1_STATE_TRAN))
+		return 0;
+
+	// Busy can be far longer than the controller's timeout, so poll status instead.
+	if (!_sdmmc_storage_execute_cmd_type1(storage, SD_ERASE, arg, 0, R1_SKIP_STATE_CHECK))
+		return 0;
+
+	u32 timeout = get_tmr_ms() + _sd_storage_erase_timeout(storage, num_sectors, arg);
+	while (true)
+	{
+		if (!_sdmmc_storage_execute_cmd_type1_ex(storage, &resp, MMC_SEND_STATUS, storage->rca << 16, 0, R1_SKIP_STATE_CHECK, 0))
+			return 0;
+
+		if (R1_CURRENT_STATE(resp) == R1_STATE_TRAN && (resp & R1_READY_FOR_DATA))
+			return 1;
+
+		if (get_tmr_ms() > timeout)
+			break;
+		usleep(100);
+	}
+
+	DPRINTF("[SD] erase timeout\n");
+
+	return 0;
 }
 
 int sd_storage_parse_perf_enhance(sdmmc_storage_t *storage, u8 fno, u8 page, u16 offset, u8 *buf)
@@ -1610,6 +2097,11 @@ int sd_storage_parse_perf_enhance(sdmmc_storage_t *storage, u8 fno, u8 page, u16
 	storage->ser.cache_ext = buf[4] & BIT(0);
 	storage->ser.cmdq_ext  = buf[6] & 0x1F;
 
+	// Save register location for enabling the features.
+	storage->ser.perf_fno    = fno;
+	storage->ser.perf_page   = page;
+	storage->ser.perf_offset = offset;
+
 	return 1;
 }
 
@@ -1673,6 +2165,289 @@ void sd_storage_get_ext_regs(sdmmc_storage_t *storage, u8 *buf)
 		_sd_storage_parse_ext_reg(storage, buf, &addr_next);
 }
 
+static int _sd_storage_set_perf_enhance(sdmmc_storage_t *storage, u16 reg, u8 val)
+{
+	u8 *buf = (u8 *)SDMMC_UPPER_BUFFER;
+
+	memset(buf, 0, SDMMC_DAT_BLOCKSIZE);
+	buf[0] = val;
+
+	return sd_storage_set_ext_reg(storage, storage->ser.perf_fno, storage->ser.perf_page,
+		storage->ser.perf_offset + reg, 1, buf);
+}
+
+int sd_storage_cache_enable(sdmmc_storage_t *storage, bool enable)
+{
+	if (!storage->ser.valid || !storage->ser.cache_ext)
+		return 0;
+
+	// Flush any cached data before disabling.
+	if (!enable && storage->ser.cache_en && !sd_storage_cache_flush(storage))
+		return 0;
+
+	if (!_sd_storage_set_perf_enhance(storage, SD_EXT_PERF_CACHE_EN, enable ? BIT(0) : 0))
+		return 0;
+
+	storage->ser.cache_en = enable;
+	DPRINTF("[SD] cache %s\n", enable ? "enabled" : "disabled");
+
+	return 1;
+}
+
+int sd_storage_cache_flush(sdmmc_storage_t *storage)
+{
+	if (!storage->ser.cache_en)
+		return 1;
+
+	// Card keeps busy until flushing is done.
+	if (!_sd_storage_set_perf_enhance(storage, SD_EXT_PERF_CACHE_FLUSH, BIT(0)))
+		return 0;
+
+	// Flush bit is cleared by the card when done. Max allowed time is 1s.
+	u8 *buf = (u8 *)SDMMC_UPPER_BUFFER;
+	u32 timeout = get_tmr_ms() + 1000;
+	while (true)
+	{
+		if (!sd_storage_get_ext_reg(storage, storage->ser.perf_fno, storage->ser.perf_page,
+			storage->ser.perf_offset + SD_EXT_PERF_CACHE_FLUSH, 1, buf))
+			return 0;
+
+		if (!(buf[0] & BIT(0)))
+			return 1;
+
+		if (get_tmr_ms() > timeout)
+			break;
+		usleep(1000);
+	}
+
+	DPRINTF("[SD] cache flush timeout\n");
+
+	return 0;
+}
+
+/*
+ * SD Card Command Queue support (SD 6.0)
+ *
+ * Tasks are queued with Q_TASK_INFO_A/B (CMD44/45) and the card reports which
+ * of them are ready for execution via the Queue Status Register (CMD13 with
+ * SEND_TASK_STATUS set). Ready tasks are then executed with Q_RD_TASK or
+ * Q_WR_TASK (CMD46/47) in any order the host wants.
+ * While queue mode is enabled, legacy read/write commands are illegal.
+ */
+u32 sd_storage_get_cmdq_depth(sdmmc_storage_t *storage)
+{
+	if (!storage->ser.valid || !storage->ser.cmdq_ext)
+		return 0;
+
+	// Register holds depth - 1.
+	return MIN(storage->ser.cmdq_ext + 1, SD_CMDQ_DEPTH_MAX);
+}
+
+int sd_storage_cmdq_enable(sdmmc_storage_t *storage, bool enable)
+{
+	if (!sd_storage_get_cmdq_depth(storage))
+		return 0;
+
+	if (!_sd_storage_set_perf_enhance(storage, SD_EXT_PERF_CMDQ_EN, enable ? BIT(0) : 0))
+		return 0;
+
+	storage->ser.cmdq_en = enable;
+	DPRINTF("[SD] cmdq %s\n", enable ? "enabled" : "disabled");
+
+	return 1;
+}
+
+u32 sd_storage_cmdq_init(sd_cmdq_t *cmdq, sdmmc_storage_t *storage, u32 depth)
+{
+	u32 max_depth = sd_storage_get_cmdq_depth(storage);
+	if (!max_depth || !depth)
+		return 0;
+
+	memset(cmdq, 0, sizeof(sd_cmdq_t));
+	cmdq->storage = storage;
+	cmdq->depth   = MIN(depth, max_depth);
+
+	if (!sd_storage_cmdq_enable(storage, true))
+		return 0;
+
+	return cmdq->depth;
+}
+
+void sd_storage_cmdq_end(sd_cmdq_t *cmdq)
+{
+	if (cmdq->queued)
+		sd_storage_cmdq_abort(cmdq);
+
+	sd_storage_cmdq_enable(cmdq->storage, false);
+}
+
+int sd_storage_cmdq_abort(sd_cmdq_t *cmdq)
+{
+	int res = _sdmmc_storage_execute_cmd_type1(cmdq->storage, SD_Q_MANAGEMENT, SD_QMGMT_ABORT_QUEUE, 1, R1_SKIP_STATE_CHECK);
+
+	// Mark all queued tasks as failed.
+	for (u32 tid = 0; tid < cmdq->depth; tid++)
+	{
+		if (cmdq->queued & BIT(tid))
+		{
+			cmdq->tasks[tid].result  = 0;
+			cmdq->tasks[tid].done_us = get_tmr_us();
+		}
+	}
+	cmdq->done  |= cmdq->queued;
+	cmdq->queued = 0;
+
+	return res;
+}
+
+int sd_storage_cmdq_get_free(sd_cmdq_t *cmdq)
+{
+	// Lowest task id that is neither queued nor waiting to be reaped.
+	u32 busy = cmdq->queued | cmdq->done;
+	for (u32 tid = 0; tid < cmdq->depth; tid++)
+		if (!(busy & BIT(tid)))
+			return tid;
+
+	return -1;
+}
+
+int sd_storage_cmdq_submit(sd_cmdq_t *cmdq, u32 sector, u32 num_sectors, void *buf, u32 is_write)
+{
+	sdmmc_storage_t *storage = cmdq->storage;
+
+	if (!storage->ser.cmdq_en || !num_sectors || num_sectors > 0xFFFF)
+		return -1;
+
+	// Check if out of bounds.
+	if (((u64)sector + num_sectors) > storage->sec_cnt)
+		return -1;
+
+	// Get a free task slot. Same one sd_storage_cmdq_get_free() returns.
+	int tid = sd_storage_cmdq_get_free(cmdq);
+	if (tid < 0)
+		return -1;
+
+	sd_cmdq_task_t *task = &cmdq->tasks[tid];
+	task->buf         = buf;
+	task->sector      = sector;
+	task->num_sectors = num_sectors;
+	task->is_write    = is_write;
+	task->result      = 0;
+	task->submit_us   = get_tmr_us();
+
+	// If SDSC convert block address to byte address.
+	if (!storage->has_sector_access)
+		sector <<= 9;
+
+	u32 arg = (is_write ? 0 : SD_QTASK_DIR_READ) | SD_QTASK_ID(tid) | num_sectors;
+	if (!_sdmmc_storage_execute_cmd_type1(storage, SD_Q_TASK_INFO_A, arg, 0, R1_SKIP_STATE_CHECK))
+		return -1;
+
+	if (!_sdmmc_storage_execute_cmd_type1(storage, SD_Q_TASK_INFO_B, sector, 0, R1_SKIP_STATE_CHECK))
+	{
+		_sdmmc_storage_execute_cmd_type1(storage, SD_Q_MANAGEMENT, SD_QTASK_ID(tid) | SD_QMGMT_ABORT_TASK, 1, R1_SKIP_STATE_CHECK);
+		return -1;
+	}
+
+	cmdq->queued |= BIT(tid);
+
+	return tid;
+}
+
+static int _sd_storage_cmdq_get_qsr(sd_cmdq_t *cmdq, u32 *qsr)
+{
+	sdmmc_cmd_t cmdbuf;
+	sdmmc_init_cmd(&cmdbuf, MMC_SEND_STATUS, cmdq->storage->rca << 16 | SD_SEND_TASK_STATUS, SDMMC_RSP_TYPE_1, 0);
+	if (!sdmmc_execute_cmd(cmdq->storage->sdmmc, &cmdbuf, NULL, NULL))
+		return 0;
+
+	// Response is the task ready mask and not a card status.
+	return sdmmc_get_cached_rsp(cmdq->storage->sdmmc, qsr, SDMMC_RSP_TYPE_1);
+}
+
+static int _sd_storage_cmdq_execute_task(sd_cmdq_t *cmdq, u32 tid)
+{
+	u32 tmp = 0;
+	sdmmc_cmd_t cmdbuf;
+	sdmmc_req_t reqbuf;
+	sd_cmdq_task_t *task = &cmdq->tasks[tid];
+
+	sdmmc_init_cmd(&cmdbuf, task->is_write ? SD_Q_WR_TASK : SD_Q_RD_TASK, SD_QTASK_ID(tid), SDMMC_RSP_TYPE_1, 0);
+
+	// Block count is known by the card, so no stop transmission is needed.
+	reqbuf.buf              = task->buf;
+	reqbuf.num_sectors      = task->num_sectors;
+	reqbuf.blksize          = SDMMC_DAT_BLOCKSIZE;
+	reqbuf.is_write         = task->is_write;
+	reqbuf.is_multi_block   = task->num_sectors > 1;
+	reqbuf.is_auto_stop_trn = 0;
+
+	if (!sdmmc_execute_cmd(cmdq->storage->sdmmc, &cmdbuf, &reqbuf, NULL))
+		return 0;
+
+	sdmmc_get_cached_rsp(cmdq->storage->sdmmc, &tmp, SDMMC_RSP_TYPE_1);
+
+	return _sdmmc_storage_check_card_status(tmp);
+}
+
+int sd_storage_cmdq_process(sd_cmdq_t *cmdq)
+{
+	u32 qsr = 0;
+	int executed = 0;
+
+	if (!cmdq->queued)
+		return 0;
+
+	if (!_sd_storage_cmdq_get_qsr(cmdq, &qsr))
+	{
+		sd_storage_cmdq_abort(cmdq);
+		return -1;
+	}
+
+	// Execute all tasks that the card marked as ready.
+	u32 ready = qsr & cmdq->queued;
+	for (u32 tid = 0; ready; tid++)
+	{
+		if (!(ready & BIT(tid)))
+			continue;
+		ready &= ~BIT(tid);
+
+		sd_cmdq_task_t *task = &cmdq->tasks[tid];
+		task->result  = _sd_storage_cmdq_execute_task(cmdq, tid);
+		task->done_us = get_tmr_us();
+
+		cmdq->queued &= ~BIT(tid);
+		cmdq->done   |= BIT(tid);
+		executed++;
+
+		// On data failure the queue state is unknown. Discard it.
+		if (!task->result)
+		{
+			sd_error_count_increment(SD_ERROR_RW_FAIL);
+			sd_storage_cmdq_abort(cmdq);
+			return -1;
+		}
+	}
+
+	return executed;
+}
+
+int sd_storage_cmdq_reap(sd_cmdq_t *cmdq, sd_cmdq_task_t *task)
+{
+	for (u32 tid = 0; tid < cmdq->depth; tid++)
+	{
+		if (cmdq->done & BIT(tid))
+		{
+			memcpy(task, &cmdq->tasks[tid], sizeof(sd_cmdq_task_t));
+			cmdq->done &= ~BIT(tid);
+
+			return tid;
+		}
+	}
+
+	return -1;
+}
+
 int sd_storage_get_ssr(sdmmc_storage_t *storage, u8 *buf)
 {
 	sdmmc_cmd_t cmdbuf;
@@ -1785,6 +2560,14 @@ static bool _sdmmc_storage_get_bus_uhs_support(u32 bus_width, u32 type)
 	}
 }
 
+static void _sd_storage_prof_step(sdmmc_storage_t *storage, u32 step, u32 *step_us)
+{
+	u32 now = get_tmr_us();
+
+	storage->init_prof.time_us[step] += now - *step_us;
+	*step_us = now;
+}
+
 void sdmmc_storage_init_wait_sd()
 {
 	// T210/T210B01 WAR: Wait exactly 239ms for IO and Controller power to discharge.
@@ -1799,6 +2582,8 @@ int sdmmc_storage_init_sd(sdmmc_storage_t *storage, sdmmc_t *sdmmc, u32 bus_widt
 	bool is_sdsc = 0;
 	u8  *buf = (u8 *)SDMMC_UPPER_BUFFER;
 	bool bus_uhs_support = _sdmmc_storage_get_bus_uhs_support(bus_width, type);
+	u32  init_us = get_tmr_us();
+	u32  step_us = init_us;
 
 	DPRINTF("[SD]-[init: bus: %d, type: %d]\n", bus_width, type);
 
@@ -1818,28 +2603,34 @@ int sdmmc_storage_init_sd(sdmmc_storage_t *storage, sdmmc_t *sdmmc, u32 bus_widt
 	if (!_sdmmc_storage_go_idle_state(storage))
 		return 0;
 	DPRINTF("[SD] went to idle state\n");
+	_sd_storage_prof_step(storage, SD_INIT_STEP_POWER, &step_us);
 
 	if (!_sd_storage_send_if_cond(storage, &is_sdsc))
 		return 0;
 	DPRINTF("[SD] after send if cond\n");
+	_sd_storage_prof_step(storage, SD_INIT_STEP_IF_COND, &step_us);
 
 	if (!_sd_storage_get_op_cond(storage, is_sdsc, bus_uhs_support))
 		return 0;
 	DPRINTF("[SD] got op cond\n");
+	_sd_storage_prof_step(storage, SD_INIT_STEP_OP_COND, &step_us);
 
 	if (!_sdmmc_storage_get_cid(storage))
 		return 0;
 	DPRINTF("[SD] got cid\n");
 	_sd_storage_parse_cid(storage);
+	_sd_storage_prof_step(storage, SD_INIT_STEP_CID, &step_us);
 
 	if (!_sd_storage_get_rca(storage))
 		return 0;
 	DPRINTF("[SD] got rca (= %04X)\n", storage->rca);
+	_sd_storage_prof_step(storage, SD_INIT_STEP_RCA, &step_us);
 
 	if (!_sdmmc_storage_get_csd(storage))
 		return 0;
 	DPRINTF("[SD] got csd\n");
 	_sd_storage_parse_csd(storage);
+	_sd_storage_prof_step(storage, SD_INIT_STEP_CSD, &step_us);
 
 	if (!storage->is_low_voltage)
 	{
@@ -1860,6 +2651,7 @@ int sdmmc_storage_init_sd(sdmmc_storage_t *storage, sdmmc_t *sdmmc, u32 bus_widt
 	if (!_sd_storage_execute_app_cmd_type1(storage, &tmp, SD_APP_SET_CLR_CARD_DETECT, 0, 0, R1_STATE_TRAN))
 		return 0;
 	DPRINTF("[SD] cleared card detect\n");
+	_sd_storage_prof_step(storage, SD_INIT_STEP_SELECT, &step_us);
 
 	if (!sd_storage_get_scr(storage, buf))
 		return 0;
@@ -1879,6 +2671,7 @@ int sdmmc_storage_init_sd(sdmmc_storage_t *storage, sdmmc_t *sdmmc, u32 bus_widt
 		bus_width = SDMMC_BUS_WIDTH_1;
 		DPRINTF("[SD] SD does not support wide bus width\n");
 	}
+	_sd_storage_prof_step(storage, SD_INIT_STEP_SCR, &step_us);
 
 	if (storage->is_low_voltage)
 	{
@@ -1904,15 +2697,21 @@ int sdmmc_storage_init_sd(sdmmc_storage_t *storage, sdmmc_t *sdmmc, u32 bus_widt
 		}
 	}
 
+	// Tuning is timed separately.
+	_sd_storage_prof_step(storage, SD_INIT_STEP_BUS_SPEED, &step_us);
+	storage->init_prof.time_us[SD_INIT_STEP_BUS_SPEED] -= storage->init_prof.time_us[SD_INIT_STEP_TUNING];
+
 	// Parse additional card info from sd status.
 	if (sd_storage_get_ssr(storage, buf))
 	{
 		DPRINTF("[SD] got sd status\n");
 	}
+	_sd_storage_prof_step(storage, SD_INIT_STEP_SSR, &step_us);
 
 	sdmmc_card_clock_powersave(sdmmc, SDMMC_POWER_SAVE_ENABLE);
 
 	storage->initialized = 1;
+	storage->init_prof.total_us = get_tmr_us() - init_us;
 
 	return 1;
 }
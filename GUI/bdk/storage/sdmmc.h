@@ -175,6 +175,11 @@ typedef struct _sd_ssr
 	u8  au_size;
 	u8  uhs_au_size;
 	u8  perf_enhance;
+	u8  discard;
+	u8  fule;
+	u16 erase_size;    // In AUs.
+	u8  erase_timeout; // In seconds, for erase_size AUs.
+	u8  erase_offset;  // In seconds.
 	u32 protected_size;
 } sd_ssr_t;
 
@@ -184,9 +189,37 @@ typedef struct _sd_ext_reg_t
 	u8  cmdq_ext;
 	u8  cache;
 	u8  cache_ext;
+	u8  perf_fno;
+	u8  perf_page;
+	u16 perf_offset;
+	int cache_en;
+	int cmdq_en;
 	int valid;
 } sd_ext_reg_t;
 
+/*! SD init profiling steps. */
+#define SD_INIT_STEP_POWER     0  // Power cycle, controller init and idle.
+#define SD_INIT_STEP_IF_COND   1
+#define SD_INIT_STEP_OP_COND   2  // ACMD41 power up and 1.8V switch.
+#define SD_INIT_STEP_CID       3
+#define SD_INIT_STEP_RCA       4
+#define SD_INIT_STEP_CSD       5
+#define SD_INIT_STEP_SELECT    6  // Select, block length and card detect.
+#define SD_INIT_STEP_SCR       7  // SCR and bus width.
+#define SD_INIT_STEP_BUS_SPEED 8  // Switch function negotiation.
+#define SD_INIT_STEP_TUNING    9
+#define SD_INIT_STEP_SSR       10
+#define SD_INIT_STEP_EXT_REGS  11 // Not part of init. Filled by the user if read.
+#define SD_INIT_STEP_MAX       12
+
+typedef struct _sd_init_prof_t
+{
+	u32 time_us[SD_INIT_STEP_MAX];
+	u16 retries[SD_INIT_STEP_MAX];
+	u32 tuning_cmds; // Tuning blocks sent while the controller searched for a tap.
+	u32 total_us;
+} sd_init_prof_t;
+
 /*! SDMMC storage context. */
 typedef struct _sdmmc_storage_t
 {
@@ -198,6 +231,7 @@ typedef struct _sdmmc_storage_t
 	u32 sec_cnt;
 	u32 partition;
 	u32 max_power;
+	int bus_cfg_cached; // Bus config restored from cache without tuning.
 	u8  raw_cid[0x10];
 	u8  raw_csd[0x10];
 	u8  raw_scr[8];
@@ -208,18 +242,61 @@ typedef struct _sdmmc_storage_t
 	sd_scr_t      scr;
 	sd_ssr_t      ssr;
 	sd_ext_reg_t  ser;
+	sd_init_prof_t init_prof;
 } sdmmc_storage_t;
 
+#define SD_CMDQ_DEPTH_MAX 32
+
+typedef struct _sd_cmdq_task_t
+{
+	void *buf;
+	u32 sector;
+	u32 num_sectors;
+	u32 is_write;
+	u32 submit_us;
+	u32 done_us;
+	int result;
+} sd_cmdq_task_t;
+
+/*! SD command queue context. Task data buffers must be SDMMC DMA capable. */
+typedef struct _sd_cmdq_t
+{
+	sdmmc_storage_t *storage;
+	u32 depth;
+	u32 queued; // Tasks queued in card, waiting for execution.
+	u32 done;   // Tasks executed, waiting for reaping.
+	sd_cmdq_task_t tasks[SD_CMDQ_DEPTH_MAX];
+} sd_cmdq_t;
+
 typedef struct _sd_func_modes_t
 {
 	u16 access_mode;
 	u16 cmd_system;
 	u16 driver_strength;
 	u16 power_limit;
+	u8  cur_driver_type;
+	u8  cur_power_limit;
 } sd_func_modes_t;
 
+#define SD_BUS_CFG_MAX 16
+
+/*! SD bus config that passed tuning, keyed by CID. */
+typedef struct _sd_bus_cfg_t
+{
+	u8 raw_cid[0x10];
+	u8 type;      // Requested SDHCI timing.
+	u8 timing;    // Negotiated SDHCI timing.
+	u8 tap;
+	u8 drv_type;
+	u8 pwr_limit;
+	u8 rsvd[3];
+} sd_bus_cfg_t;
+
 int  sdmmc_storage_end(sdmmc_storage_t *storage);
 int  sdmmc_storage_read(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf);
+int  sdmmc_storage_read_once(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf);
+int  sdmmc_storage_read_async(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf);
+int  sdmmc_storage_async_poll(sdmmc_storage_t *storage, u32 *blkcnt_out);
 int  sdmmc_storage_write(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf);
 int  sdmmc_storage_init_mmc(sdmmc_storage_t *storage, sdmmc_t *sdmmc, u32 bus_width, u32 type);
 int  sdmmc_storage_set_mmc_partition(sdmmc_storage_t *storage, u32 partition);
@@ -233,12 +310,35 @@ int  sdmmc_storage_vendor_sandisk_report(sdmmc_storage_t *storage, void *buf);
 int  mmc_storage_get_ext_csd(sdmmc_storage_t *storage, void *buf);
 
 int  sd_storage_get_ext_reg(sdmmc_storage_t *storage, u8 fno, u8 page, u16 offset, u32 len, void *buf);
+int  sd_storage_set_ext_reg(sdmmc_storage_t *storage, u8 fno, u8 page, u16 offset, u32 len, void *buf);
 int  sd_storage_get_fmodes(sdmmc_storage_t *storage, u8 *buf, sd_func_modes_t *functions);
 int  sd_storage_get_scr(sdmmc_storage_t *storage, u8 *buf);
 int  sd_storage_get_ssr(sdmmc_storage_t *storage, u8 *buf);
 u32  sd_storage_get_ssr_au(sdmmc_storage_t *storage);
+int  sd_storage_erase(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, u32 arg);
+
+void sd_storage_bus_cfg_import(const sd_bus_cfg_t *cfgs, u32 count);
+u32  sd_storage_bus_cfg_export(sd_bus_cfg_t **cfgs);
+bool sd_storage_bus_cfg_dirty(void);
+int  sd_storage_bus_cfg_store(sdmmc_storage_t *storage);
+int  sd_storage_bus_cfg_apply(sdmmc_storage_t *storage);
+bool sd_storage_bus_drive_supported(sdmmc_storage_t *storage);
+int  sd_storage_set_bus_drive(sdmmc_storage_t *storage, u32 drv_type, u32 pwr_limit);
 
 void sd_storage_get_ext_regs(sdmmc_storage_t *storage, u8 *buf);
 int  sd_storage_parse_perf_enhance(sdmmc_storage_t *storage, u8 fno, u8 page, u16 offset, u8 *buf);
 
+int  sd_storage_cache_enable(sdmmc_storage_t *storage, bool enable);
+int  sd_storage_cache_flush(sdmmc_storage_t *storage);
+
+u32  sd_storage_get_cmdq_depth(sdmmc_storage_t *storage);
+int  sd_storage_cmdq_enable(sdmmc_storage_t *storage, bool enable);
+u32  sd_storage_cmdq_init(sd_cmdq_t *cmdq, sdmmc_storage_t *storage, u32 depth);
+void sd_storage_cmdq_end(sd_cmdq_t *cmdq);
+int  sd_storage_cmdq_get_free(sd_cmdq_t *cmdq);
+int  sd_storage_cmdq_submit(sd_cmdq_t *cmdq, u32 sector, u32 num_sectors, void *buf, u32 is_write);
+int  sd_storage_cmdq_process(sd_cmdq_t *cmdq);
+int  sd_storage_cmdq_reap(sd_cmdq_t *cmdq, sd_cmdq_task_t *task);
+int  sd_storage_cmdq_abort(sd_cmdq_t *cmdq);
+
 #endif
@@ -41,6 +41,52 @@
 /*! SCMMC controller base addresses. */
 static const u16 _sdmmc_base_offsets[4] = { 0x0, 0x200, 0x400, 0x600 };
 
+#ifdef BDK_SDMMC_TRACE
+static sdmmc_trace_rec_t *_sdmmc_trace_buf = NULL;
+static u32 _sdmmc_trace_mask = 0;
+static u32 _sdmmc_trace_pos  = 0;
+
+static void _sdmmc_trace(sdmmc_t *sdmmc, u32 event, u32 cmd, u32 arg)
+{
+	if (!_sdmmc_trace_buf)
+		return;
+
+	sdmmc_trace_rec_t *rec = &_sdmmc_trace_buf[_sdmmc_trace_pos & _sdmmc_trace_mask];
+	rec->time_us = get_tmr_us();
+	rec->id      = sdmmc->id;
+	rec->event   = event;
+	rec->cmd     = cmd;
+	rec->arg     = arg;
+	_sdmmc_trace_pos++;
+}
+
+/*
+ * Starts recording into buf. Entries must be a power of 2.
+ * Once full, the oldest records are overwritten.
+ */
+void sdmmc_trace_start(sdmmc_trace_rec_t *buf, u32 entries)
+{
+	_sdmmc_trace_pos  = 0;
+	_sdmmc_trace_mask = entries - 1;
+	_sdmmc_trace_buf  = buf;
+}
+
+/*
+ * Stops recording and returns the number of records written.
+ * If higher than entries, record n is at buf[n & (entries - 1)].
+ */
+u32 sdmmc_trace_stop(void)
+{
+	_sdmmc_trace_buf = NULL;
+
+	return _sdmmc_trace_pos;
+}
+
+#define SDMMC_TRACE(sdmmc, event, cmd, arg) _sdmmc_trace(sdmmc, event, cmd, arg)
+#else
+#define SDMMC_TRACE(sdmmc, event, cmd, arg)
+#endif
+
 int sdmmc_get_io_power(sdmmc_t *sdmmc)
 {
 	u32 p = sdmmc->regs->pwrcon;
@@ -139,6 +185,29 @@ static void _sdmmc_commit_changes(sdmmc_t *sdmmc)
 	(void)sdmmc->regs->clkcon;
 }
 
+u32 sdmmc_get_tap(sdmmc_t *sdmmc)
+{
+	return (sdmmc->regs->venclkctl & 0xFF0000) >> 16;
+}
+
+/*
+ * Overrides the sampling tap selected by tuning.
+ * Only meant for diagnostics. A new tuning will replace it.
+ */
+void sdmmc_set_tap(sdmmc_t *sdmmc, u32 tap)
+{
+	u32 card_clk_en = sdmmc->regs->clkcon & SDHCI_CLOCK_CARD_EN;
+
+	sdmmc->regs->clkcon     &= ~SDHCI_CLOCK_CARD_EN;
+	sdmmc->regs->ventunctl0 &= ~SDHCI_TEGRA_TUNING_TAP_HW_UPDATED;
+
+	sdmmc->regs->venclkctl   = (sdmmc->regs->venclkctl & 0xFF00FFFF) | ((tap & 0xFF) << 16);
+
+	sdmmc->regs->ventunctl0 |=  SDHCI_TEGRA_TUNING_TAP_HW_UPDATED;
+	sdmmc->regs->clkcon     |= card_clk_en; // Keep power saving state.
+	_sdmmc_commit_changes(sdmmc);
+}
+
 static void _sdmmc_pad_config_fallback(sdmmc_t *sdmmc, u32 power)
 {
 	_sdmmc_commit_changes(sdmmc);
@@ -522,9 +591,12 @@ static int _sdmmc_wait_card_busy(sdmmc_t *sdmmc)
 		if (get_tmr_ms() > timeout)
 		{
 			_sdmmc_reset_cmd_data(sdmmc);
+			SDMMC_TRACE(sdmmc, SDMMC_TRACE_BUSY_DONE, 0, 0);
 			return 0;
 		}
 
+	SDMMC_TRACE(sdmmc, SDMMC_TRACE_BUSY_DONE, 0, 1);
+
 	return 1;
 }
 
@@ -586,6 +658,8 @@ static int _sdmmc_send_cmd(sdmmc_t *sdmmc, const sdmmc_cmd_t *cmd, bool is_data_
 	sdmmc->regs->argument = cmd->arg;
 	sdmmc->regs->cmdreg   = SDHCI_CMD_IDX(cmd->cmd) | cmdflags;
 
+	SDMMC_TRACE(sdmmc, SDMMC_TRACE_CMD_ISSUE, cmd->cmd, cmd->arg);
+
 	return 1;
 }
 
@@ -740,6 +814,7 @@ static int sdmmc_tuning_execute_ddr200(sdmmc_t *sdmmc)
 	for (u32 i = 0; i < manual_tuning.num_iter; i++)
 	{
 		_sdmmc_tuning_execute_once(sdmmc, MMC_SEND_TUNING_BLOCK, i);
+		sdmmc->tuning_cmds++;
 
 		// Save result for manual tuning.
 		int sampled = (sdmmc->regs->hostctl2 >> SDHCI_CTRL_TUNED_CLK_SHIFT) & 1;
@@ -757,6 +832,8 @@ int sdmmc_tuning_execute(sdmmc_t *sdmmc, u32 type, u32 cmd)
 {
 	u32 num_iter, flag;
 
+	sdmmc->tuning_cmds = 0;
+
 	if (sdmmc->powersave_enabled)
 		return 0;
 
@@ -800,6 +877,7 @@ int sdmmc_tuning_execute(sdmmc_t *sdmmc, u32 type, u32 cmd)
 	for (u32 i = 0; i < num_iter; i++)
 	{
 		_sdmmc_tuning_execute_once(sdmmc, cmd, HW_TAP_TUNING);
+		sdmmc->tuning_cmds++;
 
 		if (!(sdmmc->regs->hostctl2 & SDHCI_CTRL_EXEC_TUNING))
 			break;
@@ -916,6 +994,8 @@ static u32 _sdmmc_check_mask_interrupt(sdmmc_t *sdmmc, u16 *pout, u16 mask)
 		EPRINTFARGS("SDMMC%d: intsts %08X, errintsts %08X", sdmmc->id + 1, norintsts, errintsts);
 #endif
 		sdmmc->error_sts = errintsts;
+		if (!sdmmc->last_error_sts)
+			sdmmc->last_error_sts = errintsts;
 		sdmmc->regs->errintsts = errintsts;
 		return SDMMC_MASKINT_ERROR;
 	}
@@ -941,10 +1021,13 @@ static int _sdmmc_wait_response(sdmmc_t *sdmmc)
 		if (result != SDMMC_MASKINT_NOERROR || get_tmr_ms() > timeout)
 		{
 			_sdmmc_reset_cmd_data(sdmmc);
+			SDMMC_TRACE(sdmmc, SDMMC_TRACE_RSP_DONE, 0, 0);
 			return 0;
 		}
 	}
 
+	SDMMC_TRACE(sdmmc, SDMMC_TRACE_RSP_DONE, 0, 1);
+
 	return 1;
 }
 
@@ -1067,7 +1150,10 @@ static int _sdmmc_update_sdma(sdmmc_t *sdmmc)
 					break;
 
 				if (intr & SDHCI_INT_DATA_END)
+				{
+					SDMMC_TRACE(sdmmc, SDMMC_TRACE_DATA_DONE, 0, 1);
 					return 1; // Transfer complete.
+				}
 
 				if (intr & SDHCI_INT_DMA_END)
 				{
@@ -1075,6 +1161,7 @@ static int _sdmmc_update_sdma(sdmmc_t *sdmmc)
 					sdmmc->regs->admaaddr = sdmmc->dma_addr_next;
 					sdmmc->regs->admaaddr_hi = 0;
 					sdmmc->dma_addr_next += SZ_512K;
+					SDMMC_TRACE(sdmmc, SDMMC_TRACE_DMA_BOUNDARY, 0, sdmmc->dma_addr_next);
 				}
 			}
 
@@ -1084,6 +1171,7 @@ static int _sdmmc_update_sdma(sdmmc_t *sdmmc)
 				EPRINTFARGS("SDMMC%d: int error!", sdmmc->id + 1);
 #endif
 				_sdmmc_reset_cmd_data(sdmmc);
+				SDMMC_TRACE(sdmmc, SDMMC_TRACE_DATA_DONE, 0, 0);
 
 				return 0;
 			}
@@ -1091,12 +1179,15 @@ static int _sdmmc_update_sdma(sdmmc_t *sdmmc)
 	} while (sdmmc->regs->blkcnt != blkcnt);
 
 	_sdmmc_reset_cmd_data(sdmmc);
+	SDMMC_TRACE(sdmmc, SDMMC_TRACE_DATA_DONE, 0, 0);
 
 	return 0;
 }
 
 static int _sdmmc_execute_cmd_inner(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req, u32 *blkcnt_out)
 {
+	SDMMC_TRACE(sdmmc, SDMMC_TRACE_CMD_START, cmd->cmd, req ? req->num_sectors : 0);
+
 	bool has_req_or_check_busy = req || cmd->check_busy;
 	if (!_sdmmc_wait_cmd_data_inhibit(sdmmc, has_req_or_check_busy))
 		return 0;
@@ -1499,6 +1590,7 @@ int sdmmc_execute_cmd(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req, u32 *b
 	}
 
 	int result = _sdmmc_execute_cmd_inner(sdmmc, cmd, req, blkcnt_out);
+	SDMMC_TRACE(sdmmc, SDMMC_TRACE_CMD_END, cmd->cmd, result);
 	usleep((8 * 1000 + sdmmc->card_clock - 1) / sdmmc->card_clock); // Wait 8 cycles.
 
 	if (should_disable_sd_clock)
@@ -1507,6 +1599,144 @@ int sdmmc_execute_cmd(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req, u32 *b
 	return result;
 }
 
+/*
+ * Asynchronous data commands
+ *
+ * Issues a data command and returns after its response, leaving the SDMA
+ * transfer running. sdmmc_poll_cmd_async() must then be called until it does
+ * not return SDMMC_ASYNC_BUSY. That allows a transfer on another controller
+ * to run in parallel. Only one async command per controller is supported.
+ */
+int sdmmc_execute_cmd_async(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req)
+{
+	if (!sdmmc->card_clock_enabled || sdmmc->async_active || !req)
+		return 0;
+
+	// Recalibrate periodically if needed.
+	if (sdmmc->periodic_calibration && sdmmc->powersave_enabled)
+		_sdmmc_autocal_execute(sdmmc, sdmmc_get_io_power(sdmmc));
+
+	sdmmc->async_clk_disable = 0;
+	if (!(sdmmc->regs->clkcon & SDHCI_CLOCK_CARD_EN))
+	{
+		sdmmc->async_clk_disable = 1;
+		sdmmc->regs->clkcon |= SDHCI_CLOCK_CARD_EN;
+		_sdmmc_commit_changes(sdmmc);
+		usleep((8 * 1000 + sdmmc->card_clock - 1) / sdmmc->card_clock); // Wait 8 cycles.
+	}
+
+	SDMMC_TRACE(sdmmc, SDMMC_TRACE_CMD_START, cmd->cmd, req->num_sectors);
+
+	int result = 0;
+	if (!_sdmmc_wait_cmd_data_inhibit(sdmmc, true))
+		goto out;
+
+	if (!_sdmmc_config_sdma(sdmmc, &sdmmc->async_blkcnt, req))
+		goto out;
+
+	// Flush cache before starting the transfer.
+	bpmp_mmu_maintenance(BPMP_MMU_MAINT_CLEAN_WAY, false);
+
+	_sdmmc_enable_interrupts(sdmmc);
+
+	if (!_sdmmc_send_cmd(sdmmc, cmd, true))
+		goto out_mask;
+
+	if (!_sdmmc_wait_response(sdmmc))
+		goto out_mask;
+
+	sdmmc->expected_rsp_type = cmd->rsp_type;
+	if (!_sdmmc_cache_rsp(sdmmc, sdmmc->rsp, cmd->rsp_type))
+		goto out_mask;
+
+	sdmmc->async_auto_stop = req->is_auto_stop_trn;
+	sdmmc->async_timeout   = get_tmr_ms() + 1500;
+	sdmmc->async_active    = 1;
+
+	return 1;
+
+out_mask:
+	_sdmmc_mask_interrupts(sdmmc);
+out:
+	SDMMC_TRACE(sdmmc, SDMMC_TRACE_CMD_END, cmd->cmd, 0);
+	usleep((8 * 1000 + sdmmc->card_clock - 1) / sdmmc->card_clock); // Wait 8 cycles.
+
+	if (sdmmc->async_clk_disable)
+		sdmmc->regs->clkcon &= ~SDHCI_CLOCK_CARD_EN;
+
+	return result;
+}
+
+static int _sdmmc_finish_cmd_async(sdmmc_t *sdmmc, int result, u32 *blkcnt_out)
+{
+	_sdmmc_mask_interrupts(sdmmc);
+
+	if (result)
+	{
+		// Invalidate cache after transfer.
+		bpmp_mmu_maintenance(BPMP_MMU_MAINT_INVALID_WAY, false);
+
+		if (blkcnt_out)
+			*blkcnt_out = sdmmc->async_blkcnt;
+
+		if (sdmmc->async_auto_stop)
+			sdmmc->stop_trn_rsp = sdmmc->regs->rspreg[3];
+
+		result = _sdmmc_wait_card_busy(sdmmc);
+	}
+
+	SDMMC_TRACE(sdmmc, SDMMC_TRACE_CMD_END, 0, result);
+	usleep((8 * 1000 + sdmmc->card_clock - 1) / sdmmc->card_clock); // Wait 8 cycles.
+
+	if (sdmmc->async_clk_disable)
+		sdmmc->regs->clkcon &= ~SDHCI_CLOCK_CARD_EN;
+
+	sdmmc->async_active = 0;
+
+	return result ? SDMMC_ASYNC_DONE : SDMMC_ASYNC_ERROR;
+}
+
+int sdmmc_poll_cmd_async(sdmmc_t *sdmmc, u32 *blkcnt_out)
+{
+	if (!sdmmc->async_active)
+		return SDMMC_ASYNC_ERROR;
+
+	u16 intr = 0;
+	u32 result = _sdmmc_check_mask_interrupt(sdmmc, &intr, SDHCI_INT_DATA_END | SDHCI_INT_DMA_END);
+
+	if (result == SDMMC_MASKINT_MASKED)
+	{
+		if (intr & SDHCI_INT_DATA_END)
+		{
+			SDMMC_TRACE(sdmmc, SDMMC_TRACE_DATA_DONE, 0, 1);
+			return _sdmmc_finish_cmd_async(sdmmc, 1, blkcnt_out); // Transfer complete.
+		}
+
+		if (intr & SDHCI_INT_DMA_END)
+		{
+			// Update DMA.
+			sdmmc->regs->admaaddr = sdmmc->dma_addr_next;
+			sdmmc->regs->admaaddr_hi = 0;
+			sdmmc->dma_addr_next += SZ_512K;
+			sdmmc->async_timeout = get_tmr_ms() + 1500;
+			SDMMC_TRACE(sdmmc, SDMMC_TRACE_DMA_BOUNDARY, 0, sdmmc->dma_addr_next);
+		}
+
+		return SDMMC_ASYNC_BUSY;
+	}
+
+	if (result == SDMMC_MASKINT_NOERROR && get_tmr_ms() < sdmmc->async_timeout)
+		return SDMMC_ASYNC_BUSY;
+
+#ifdef ERROR_EXTRA_PRINTING
+	EPRINTFARGS("SDMMC%d: async transfer failed!", sdmmc->id + 1);
+#endif
+	_sdmmc_reset_cmd_data(sdmmc);
+	SDMMC_TRACE(sdmmc, SDMMC_TRACE_DATA_DONE, 0, 0);
+
+	return _sdmmc_finish_cmd_async(sdmmc, 0, blkcnt_out);
+}
+
 int sdmmc_enable_low_voltage(sdmmc_t *sdmmc)
 {
 	if (sdmmc->id != SDMMC_1)
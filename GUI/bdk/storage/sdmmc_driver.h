@@ -278,6 +278,30 @@
 #define INVALID_TAP              0x100
 #define SAMPLING_WINDOW_SIZE_MIN 8
 
+/*! SDMMC trace events. */
+#define SDMMC_TRACE_CMD_START    0 // Command execution entered.
+#define SDMMC_TRACE_CMD_ISSUE    1 // Command written to the controller.
+#define SDMMC_TRACE_RSP_DONE     2 // Response received or failed.
+#define SDMMC_TRACE_DMA_BOUNDARY 3 // SDMA 512KB boundary reached.
+#define SDMMC_TRACE_DATA_DONE    4 // Data phase finished (includes auto CMD12).
+#define SDMMC_TRACE_BUSY_DONE    5 // Card released DAT0 busy.
+#define SDMMC_TRACE_CMD_END      6 // Command execution finished.
+
+/*! SDMMC trace record. */
+typedef struct _sdmmc_trace_rec_t
+{
+	u32 time_us;
+	u8  id;
+	u8  event;
+	u16 cmd;
+	u32 arg; // Event specific: sector count, command argument, DMA address or result.
+} sdmmc_trace_rec_t;
+
+/*! SDMMC async command states. */
+#define SDMMC_ASYNC_ERROR -1
+#define SDMMC_ASYNC_BUSY   0
+#define SDMMC_ASYNC_DONE   1
+
 /*! SDMMC controller context. */
 typedef struct _sdmmc_t
 {
@@ -295,7 +319,14 @@ typedef struct _sdmmc_t
 	u32 rsp[4];
 	u32 stop_trn_rsp;
 	u32 error_sts;
+	u32 last_error_sts; // First error since cleared by the caller. Survives recovery.
+	u32 tuning_cmds;    // Tuning blocks sent by the last sdmmc_tuning_execute.
 	int t210b01;
+	int async_active;      // Data command started with sdmmc_execute_cmd_async.
+	int async_clk_disable; // Disable card clock when it completes.
+	int async_auto_stop;
+	u32 async_blkcnt;
+	u32 async_timeout;
 } sdmmc_t;
 
 /*! SDMMC command. */
@@ -322,6 +353,8 @@ int  sdmmc_get_io_power(sdmmc_t *sdmmc);
 u32  sdmmc_get_bus_width(sdmmc_t *sdmmc);
 void sdmmc_set_bus_width(sdmmc_t *sdmmc, u32 bus_width);
 void sdmmc_save_tap_value(sdmmc_t *sdmmc);
+u32  sdmmc_get_tap(sdmmc_t *sdmmc);
+void sdmmc_set_tap(sdmmc_t *sdmmc, u32 tap);
 void sdmmc_setup_drv_type(sdmmc_t *sdmmc, u32 type);
 int  sdmmc_setup_clock(sdmmc_t *sdmmc, u32 type);
 void sdmmc_card_clock_powersave(sdmmc_t *sdmmc, int powersave_enable);
@@ -333,6 +366,13 @@ int  sdmmc_init(sdmmc_t *sdmmc, u32 id, u32 power, u32 bus_width, u32 type);
 void sdmmc_end(sdmmc_t *sdmmc);
 void sdmmc_init_cmd(sdmmc_cmd_t *cmdbuf, u16 cmd, u32 arg, u32 rsp_type, u32 check_busy);
 int  sdmmc_execute_cmd(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req, u32 *blkcnt_out);
+int  sdmmc_execute_cmd_async(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req);
+int  sdmmc_poll_cmd_async(sdmmc_t *sdmmc, u32 *blkcnt_out);
 int  sdmmc_enable_low_voltage(sdmmc_t *sdmmc);
 
+#ifdef BDK_SDMMC_TRACE
+void sdmmc_trace_start(sdmmc_trace_rec_t *buf, u32 entries);
+u32  sdmmc_trace_stop(void);
+#endif
+
 #endif
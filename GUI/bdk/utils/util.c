@@ -211,6 +211,9 @@ u32 crc32_calc(u32 crc, const u8 *buf, u32 len)
 	if (!table)
 	{
 		table = zalloc(256 * sizeof(u32));
+#ifdef BDK_MALLOC_TRACK
+		heap_track_keep(table); // Kept for the lifetime of the payload.
+#endif
 		for (u32 i = 0; i < 256; i++)
 		{
 			u32 rem = i;
@@ -0,0 +1,319 @@
+/*
+ * SD Card Read Tester - Batch Mode Entry Point
+ *
+ * Copyright (c) 2026
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+// Headless build (make batch): runs the tests listed in BATCH_PLAN_FILE in
+// order, writes a plain text report to BATCH_RESULTS_FILE and reboots. No
+// LVGL or touch, status goes to the gfx console when the plan enables it.
+//
+// Plan format, one section per test:
+//   [batch]        display=0|1, reboot=0|1 (0 powers off), device=sd|gpp|...
+//   [seq]          sectors=N (0 = whole device)
+//   [btf]          iterations=N (0 = until the pointers meet)
+//   [random]       ios=N, qd=N
+//   [write_cache]
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include <bdk.h>
+
+#include "gfx/gfx.h"
+
+#include "sd_tester.h"
+
+// Boot configuration
+hekate_config h_cfg;
+boot_cfg_t __attribute__((section("._boot_cfg"))) b_cfg;
+
+extern void pivot_stack(u32 stack_top);
+
+static bool console = false;
+static u32 progress_percent;
+
+static void status(const char *fmt, ...) {
+  if (!console)
+    return;
+
+  va_list ap;
+  va_start(ap, fmt);
+  gfx_vprintf(fmt, ap);
+  va_end(ap);
+}
+
+// Rewrites the end of the current console line, only when the percentage
+// changes since console text is drawn by the CPU
+static void batch_progress(u32 current, u32 total, u32 latency, u32 errors) {
+  if (!console || !total)
+    return;
+
+  u32 percent = current * 100 / total;
+  if (percent == progress_percent)
+    return;
+  progress_percent = percent;
+
+  u32 x, y;
+  gfx_con_getpos(&x, &y);
+  gfx_printf("%3d%% | %6d us | %d   ", percent, latency, errors);
+  gfx_con_setpos(x, y);
+}
+
+static u32 plan_get(ini_sec_t *sec, const char *key, u32 def) {
+  LIST_FOREACH_ENTRY(ini_kv_t, kv, &sec->kvs, link) {
+    if (!strcmp(kv->key, key))
+      return atoi(kv->val);
+  }
+  return def;
+}
+
+static const char *plan_get_str(ini_sec_t *sec, const char *key) {
+  LIST_FOREACH_ENTRY(ini_kv_t, kv, &sec->kvs, link) {
+    if (!strcmp(kv->key, key))
+      return kv->val;
+  }
+  return NULL;
+}
+
+static char *report_io(char *p, sd_test_result_t *res) {
+  s_printf(p, "Blocks: %d | Errors: %d\n", res->blocks_tested,
+           res->read_errors);
+  p += strlen(p);
+  s_printf(p, "Latency: Min %d / Max %d / Avg %d us\n",
+           res->min_latency_us == 0xFFFFFFFF ? 0 : res->min_latency_us,
+           res->max_latency_us, sd_tester_get_avg_latency(res));
+  p += strlen(p);
+  s_printf(p, "Slow blocks (>5ms): %d\n", res->slow_blocks);
+  p += strlen(p);
+
+  return p;
+}
+
+// Runs one plan section and appends its report. Returns 1 if it failed
+static int batch_run_test(ini_sec_t *sec, char **pp) {
+  char *p = *pp;
+  int failed = 0;
+
+  s_printf(p, "\n[%s]\n", sec->name);
+  p += strlen(p);
+
+  if (!strcmp(sec->name, "seq")) {
+    sd_test_result_t res;
+    u32 start_us = get_tmr_us();
+    if (sd_tester_run_sequential(&res, plan_get(sec, "sectors",
+                                                FAST_TEST_SECTORS),
+                                 batch_progress)) {
+      s_printf(p, "Failed to allocate the read buffer\n");
+      failed = 1;
+    } else {
+      p = report_io(p, &res);
+      s_printf(p, "Throughput: %d KB/s\n",
+               sd_tester_get_kbps(res.blocks_passed * BLOCKS_PER_READ,
+                                  get_tmr_us() - start_us));
+      failed = !sd_tester_is_passed(&res);
+    }
+  } else if (!strcmp(sec->name, "btf")) {
+    sd_test_result_t res;
+    if (sd_tester_run_butterfly(&res, plan_get(sec, "iterations",
+                                               FAST_BUTTERFLY_ITER),
+                                batch_progress)) {
+      s_printf(p, "Failed to allocate the read buffer\n");
+      failed = 1;
+    } else {
+      p = report_io(p, &res);
+      failed = !sd_tester_is_passed(&res);
+    }
+  } else if (!strcmp(sec->name, "random")) {
+    sd_qd_result_t res;
+    int err = sd_tester_run_random_qd(&res,
+                                      plan_get(sec, "ios", RANDOM_IO_COUNT),
+                                      plan_get(sec, "qd", 1), batch_progress);
+    if (err == -2) {
+      s_printf(p, "Command queueing not supported by this device\n");
+    } else if (err) {
+      s_printf(p, "Failed to allocate the read buffer\n");
+      failed = 1;
+    } else {
+      s_printf(p, "QD%d: %d IOPS (%d KB/s)\n", res.queue_depth,
+               sd_tester_get_iops(&res),
+               sd_tester_get_iops(&res) * RANDOM_IO_SECTORS / 2);
+      p += strlen(p);
+      p = report_io(p, &res.io);
+      failed = res.io.read_errors != 0;
+    }
+  } else if (!strcmp(sec->name, "write_cache")) {
+    sd_cache_result_t res;
+    int err = sd_tester_run_write_cache(&res, batch_progress);
+    if (err == -3) {
+      s_printf(p, "Not enough contiguous free space\n");
+      failed = 1;
+    } else if (err == -4) {
+      s_printf(p, "Failed to erase the scratch range\n");
+      failed = 1;
+    } else if (err) {
+      s_printf(p, "Failed to create scratch file\n");
+      failed = 1;
+    } else {
+      s_printf(p, "Cache off: %d KB/s | Max latency: %d us\n",
+               sd_tester_get_kbps(res.sectors, res.nocache_us),
+               res.nocache.max_latency_us);
+      p += strlen(p);
+      if (res.cache_supported)
+        s_printf(p, "Cache on: %d KB/s | Flush: %d us\n",
+                 sd_tester_get_kbps(res.sectors, res.cache_us), res.flush_us);
+      else
+        s_printf(p, "Card has no volatile cache\n");
+      failed = res.nocache.write_errors + res.cache.write_errors != 0;
+    }
+  } else {
+    s_printf(p, "Unknown test, skipped\n");
+  }
+
+  p += strlen(p);
+  *pp = p;
+  return failed;
+}
+
+// Returns 1 once the named device is selected
+static int batch_set_device(const char *name) {
+  static const char *names[TEST_DEV_MAX] = {"sd", "gpp", "boot0", "boot1"};
+
+  for (u32 dev = 0; dev < TEST_DEV_MAX; dev++) {
+    if (!strcmp(name, names[dev]))
+      return sd_tester_set_device(dev);
+  }
+  return 0;
+}
+
+static void batch_exit(bool reboot) {
+  sd_end();
+  power_set_state(reboot ? POWER_OFF_REBOOT : POWER_OFF);
+}
+
+void ipl_main(void) {
+  static char results[BATCH_RESULTS_SZ];
+
+  // Startup phases, measured from payload entry. Static, the stack moves
+  static u32 entry_us;
+  entry_us = get_tmr_us();
+
+  hw_init();
+  pivot_stack(IPL_STACK_TOP);
+  heap_init((void *)IPL_HEAP_START);
+
+  char *p = results;
+
+  memset(&h_cfg, 0, sizeof(hekate_config));
+
+  // Boost first, so the SD init and mount run at full speed
+  bpmp_clk_rate_set(BPMP_CLK_DEFAULT_BOOST);
+  u32 hw_us = get_tmr_us();
+
+  int sd_mounted = sd_mount();
+  if (sd_mounted)
+    sd_tester_sync_bus_cfg();
+  u32 mount_us = get_tmr_us();
+
+  link_t plan;
+  list_init(&plan);
+  int plan_ok = sd_mounted && ini_parse(&plan, BATCH_PLAN_FILE, false);
+
+  u32 display = 1, reboot = 1;
+  const char *device = NULL;
+  if (plan_ok) {
+    LIST_FOREACH_ENTRY(ini_sec_t, sec, &plan, link) {
+      if (sec->type == INI_CHOICE && !strcmp(sec->name, "batch")) {
+        display = plan_get(sec, "display", 1);
+        reboot = plan_get(sec, "reboot", 1);
+        device = plan_get_str(sec, "device");
+      }
+    }
+  }
+  u32 plan_us = get_tmr_us();
+
+  // Errors are always shown, the console is optional otherwise
+  if (display || !plan_ok) {
+    display_init();
+    u32 *fb = display_init_window_a_pitch();
+    gfx_init_ctxt(fb, 720, 1280, 720);
+    gfx_con_init();
+    display_backlight_pwm_init();
+    display_backlight_brightness(100, 0);
+    console = true;
+  }
+  u32 console_us = get_tmr_us();
+
+  status("SD Card Tester v" XSTR(SD_TESTER_VER_MJ) "." XSTR(
+      SD_TESTER_VER_MN) " batch mode\n\n");
+
+  if (!plan_ok) {
+    status(sd_mounted ? "Error: No test plan at " BATCH_PLAN_FILE "\n"
+                      : "Error: Failed to mount SD card!\n");
+    msleep(BATCH_ERROR_MS);
+    batch_exit(reboot);
+  }
+
+  s_printf(p, "SD Card Tester v" XSTR(SD_TESTER_VER_MJ) "." XSTR(
+               SD_TESTER_VER_MN) " batch results\n");
+  p += strlen(p);
+
+  if (device && !batch_set_device(device)) {
+    s_printf(p, "Device %s not available, using SD\n", device);
+    p += strlen(p);
+  }
+  s_printf(p, "Device: %s\n",
+           sd_tester_get_device_string(sd_tester_get_device()));
+  p += strlen(p);
+
+  u32 first_io_us = 0;
+  u32 tests = 0, failed = 0;
+  LIST_FOREACH_ENTRY(ini_sec_t, sec, &plan, link) {
+    if (sec->type != INI_CHOICE || !strcmp(sec->name, "batch"))
+      continue;
+
+    if (!first_io_us)
+      first_io_us = get_tmr_us();
+
+    status("%s: ", sec->name);
+    progress_percent = ~0;
+    u32 test_failed = batch_run_test(sec, &p);
+    status("%s\n", test_failed ? "FAILED                     "
+                               : "OK                         ");
+
+    tests++;
+    failed += test_failed;
+
+    // Leave room for the summary
+    if (p - results > BATCH_RESULTS_SZ - 1024) {
+      s_printf(p, "\nResults full, remaining tests skipped\n");
+      p += strlen(p);
+      break;
+    }
+  }
+  ini_free(&plan);
+
+  s_printf(p, "\nStartup: hw init %d ms, SD mount %d ms, plan %d ms, "
+              "console %d ms, first test I/O at %d ms\n",
+           (hw_us - entry_us) / 1000, (mount_us - hw_us) / 1000,
+           (plan_us - mount_us) / 1000, (console_us - plan_us) / 1000,
+           ((first_io_us ? first_io_us : get_tmr_us()) - entry_us) / 1000);
+  p += strlen(p);
+  s_printf(p, "Result: %s, %d of %d tests failed\n",
+           failed ? "FAILED" : "PASSED", failed, tests);
+  p += strlen(p);
+
+  f_mkdir(SCRATCH_DIR);
+  if (sd_save_to_file(results, p - results, BATCH_RESULTS_FILE))
+    status("\nError: Failed to write " BATCH_RESULTS_FILE "\n");
+  else
+    status("\nResults written to " BATCH_RESULTS_FILE "\n");
+
+  msleep(BATCH_DONE_MS);
+  batch_exit(reboot);
+}
@@ -38,9 +38,102 @@
 #define LATENCY_SLOW_US 5000 // 5 ms = slow block warning
 #define LATENCY_BAD_US 50000 // 50 ms = potential bad block
 
+// Random I/O test (4 KB aligned reads)
+#define RANDOM_IO_SECTORS 8 // 4 KB per I/O
+#define RANDOM_IO_COUNT 8192 // I/Os per queue depth pass
+
+// Write tests run inside a preallocated scratch file, never over user data
+#define SCRATCH_DIR "sd_tester"
+#define SCRATCH_FILE SCRATCH_DIR "/scratch.bin"
+#define WRITE_BENCH_SECTORS (128 * 1024) // 64 MB per write pass
+#define ERASE_BENCH_SECTORS (256 * 1024) // 128 MB erase/discard region
+#define DEFAULT_AU_SECTORS (8 * 1024)    // 4 MB if the card reports no AU
+
+// Per card bus mode/tap cache, used to skip tuning on next init
+#define BUS_CFG_FILE SCRATCH_DIR "/buscfg.bin"
+#define BUS_CFG_MAGIC 0x47464342 // "BCFG"
+
+// Driver trace (needs SDMMC_TRACE=1 at build time)
+#define TRACE_ENTRIES 4096 // Ring buffer records (power of 2)
+#define TRACE_IOS 256      // I/Os traced per workload
+
+// Heap report written at test end (needs HEAP_TRACK=1 for allocation sites)
+#define HEAP_DUMP_FILE SCRATCH_DIR "/heap.txt"
+#define HEAP_DUMP_SITES 32 // Allocation sites listed
+
+// Render monitor (needs GUI_MONITOR=1). The log keeps the last frames of each
+// sequential/butterfly job, the overlay averages over REFR_OVERLAY_MS
+#define REFR_LOG_FILE SCRATCH_DIR "/refr.txt"
+#define REFR_LOG_FRAMES 1024
+#define REFR_OVERLAY_MS 500
+
+// Tuning window scan (tuned UHS modes sample over 128 taps)
+#define TAP_SCAN_TAPS 128
+#define TAP_SCAN_READS 8      // 64 KB reads per tap
+#define TAP_SCAN_MAX_ERRORS 2 // Stop reading a tap after this many errors
+
+// Driver type / power limit sweep
+#define DRIVE_SWEEP_READS 64 // 64 KB reads per setting (4 MB)
+#define DRIVE_SWEEP_PWR_LIMITS 2 // 0.72W and 1.44W, the UHS-I cap init also uses
+
+// Concurrent SD + eMMC reads (eMMC is only read)
+#define DUAL_IO_READS 1024 // 64 KB reads per device per pass (64 MB)
+
+// emuMMC read through BIS (XTS decryption and cluster cache)
+#define EMUMMC_INI "emuMMC/emummc.ini"
+#define BIS_BENCH_SECTORS (128 * 1024) // 64 MB of SYSTEM per pass
+#define BIS_RANDOM_IOS 4096            // 4 KB reads inside the same range
+#define BIS_REPLAY_IOS 8192            // 4 KB reads of the hot/cold replay
+#define BIS_REPLAY_CACHE 1024          // Cache bound for the replay (16 MB)
+#define BIS_REPLAY_HOT 512             // Hot set clusters (8 MB), 80% of reads
+
 // Progress update frequency
 #define PROGRESS_UPDATE_SECTORS 8192 // Update progress every 4 MB
 
+// Sequential/butterfly jobs read for this long between GUI updates. Long next
+// to one progress redraw, so throughput stays close to an uninterrupted loop
+#define JOB_STEP_US 100000
+
+// Live job charts. Throughput and p99 are taken per TREND_INTERVAL_US of
+// device busy time, so pauses and GUI work do not show up as stalls. Older
+// intervals are merged pairwise to keep TREND_POINTS buckets
+#define TREND_POINTS 128
+#define TREND_LBA_POINTS 128
+#define TREND_INTERVAL_US 250000
+#define TREND_LAT_BINS 96 // 4 bins per octave up to 16 s
+
+// Surface map under the job charts. Each cell is coloured by the slowest
+// read that touched it
+#define SURFACE_COLS 128
+#define SURFACE_ROWS 16
+#define SURFACE_PITCH 9 // Pixels per cell, including a 1 pixel gap
+#define SURFACE_FAST_US 1000
+#define SURFACE_OK_US 5000
+#define SURFACE_SLOW_US 50000
+#define SURFACE_INV_MAX 24 // Cells redrawn per update, under LV_INV_FIFO_SIZE
+
+// CCPLEX worker (worker/, built with make worker)
+#define WORKER_FILE SCRATCH_DIR "/worker.bin"
+#define WORKER_TIMEOUT_MS 1000
+#define WORKER_MMU_ENTRY 2                 // BPMP MMU entry for DRAM above the ring
+#define WORKER_BENCH_SIZE (4 * 1024 * 1024) // Buffer per benchmark pass
+#define WORKER_BENCH_PASSES 16             // 64 MB per operation
+
+// Batch build (make batch): test plan in, plain text results out
+#define BATCH_PLAN_FILE SCRATCH_DIR "/batch.ini"
+#define BATCH_RESULTS_FILE SCRATCH_DIR "/batch.txt"
+#define BATCH_RESULTS_SZ 8192
+#define BATCH_ERROR_MS 5000 // Error shown before rebooting
+#define BATCH_DONE_MS 2000
+
+// Display flush rotates the LVGL area in square tiles (pixels per side)
+#define FLUSH_TILE 16
+
+// Software flush renders into a back buffer and flips on vblank. Areas of the
+// last frame are copied into the new back buffer, overflow merges into one
+#define FLIP_DIRTY_AREAS 16
+#define FRAME_STATS_MS 500 // Frame stats label refresh on the job screen
+
 // Memory addresses (IPL_HEAP_START is in bdk/memory_map.h)
 #define IPL_STACK_TOP 0x83100000
 
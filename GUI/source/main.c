@@ -21,7 +21,11 @@
 #include "gfx/gfx.h"
 #include <libs/lvgl/lvgl.h>
 
+#include "rotate.h"
 #include "sd_tester.h"
+#ifdef SD_TESTER_STUB
+#include "stub.h"
+#endif
 
 // Boot configuration
 hekate_config h_cfg;
@@ -43,6 +47,9 @@ static lv_style_t style_result;
 // Forward declarations
 static void create_main_menu(void);
 static void run_test_gui(test_mode_t mode);
+static lv_obj_t *create_btn(lv_obj_t *parent, const char *label,
+                            lv_action_t action);
+static void display_report_gui(const char *text);
 
 // Progress callback adapter for GUI
 static sd_test_result_t *current_result = NULL;
@@ -57,9 +64,6 @@ static void gui_seq_progress(u32 current, u32 total, u32 latency, u32 errors) {
     s_printf(buf, "Sequential: %d%% | Latency: %d us | Errors: %d", percent,
              latency, errors);
     lv_label_set_text(status_label, buf);
-
-    // Process LV tasks to update display
-    lv_task_handler();
   }
 }
 
@@ -73,21 +77,94 @@ static void gui_btf_progress(u32 current, u32 total, u32 lat_low,
     s_printf(buf, "Butterfly: %d%% | Low: %d us | High: %d us", percent,
              lat_low, lat_high);
     lv_label_set_text(status_label, buf);
+  }
+}
+
+// Generic progress for the performance tests, prefixed by the running test
+static const char *io_progress_name = "";
+
+static void gui_io_progress(u32 current, u32 total, u32 latency, u32 errors) {
+  if (total > 0) {
+    u32 percent = current * 100 / total;
+    lv_bar_set_value(progress_bar, percent);
+
+    char buf[128];
+    s_printf(buf, "%s: %d%% | Latency: %d us | Errors: %d", io_progress_name,
+             percent, latency, errors);
+    lv_label_set_text(status_label, buf);
 
     lv_task_handler();
   }
 }
 
+#ifdef BDK_MALLOC_TRACK
+// Heap overlay, refreshed from the LV task handler so it also runs mid test
+static lv_obj_t *heap_label = NULL;
+static bool heap_test_running = false;
+
+static void heap_overlay_task(void *param) {
+  heap_stats_t stats;
+  heap_get_stats(&stats);
+
+  // LVGL objects, styles and strings live in their own pool at NYX_LV_MEM_ADR
+  lv_mem_monitor_t lv_mon;
+  lv_mem_monitor(&lv_mon);
+
+  char buf[192];
+  s_printf(buf,
+           "Heap %d/%d KB | Largest free %d KB | Frag %d%% | Allocs %d\n"
+           "LVGL %d/%d KB | Largest free %d KB | Frag %d%% | Allocs %d",
+           stats.used >> 10, stats.peak >> 10, stats.largest_free >> 10,
+           stats.frag / 10, stats.allocs,
+           (lv_mon.total_size - lv_mon.free_size) >> 10,
+           lv_mon.total_size >> 10, lv_mon.free_biggest_size >> 10,
+           lv_mon.frag_pct, lv_mon.used_cnt);
+  lv_label_set_text(heap_label, buf);
+}
+
+static void heap_overlay_init(void) {
+  static lv_style_t heap_style;
+  lv_style_copy(&heap_style, &lv_style_plain);
+  heap_style.text.color = LV_COLOR_HEX(0xFFDD00);
+
+  heap_label = lv_label_create(lv_layer_top(), NULL);
+  lv_obj_set_style(heap_label, &heap_style);
+  heap_overlay_task(NULL); // Two lines of text before aligning to the bottom
+  lv_obj_align(heap_label, NULL, LV_ALIGN_IN_BOTTOM_LEFT, LV_DPI / 8,
+               -LV_DPI / 8);
+  lv_task_create(heap_overlay_task, 500, LV_TASK_PRIO_LOW, NULL);
+}
+#endif
+
 // Message box button callback
 static lv_res_t mbox_action(lv_obj_t *mbox, const char *txt) {
   lv_obj_del(mbox->par); // Delete dark background (parent)
+
+#ifdef BDK_MALLOC_TRACK
+  // Leak report for the finished test
+  if (heap_test_running) {
+    heap_test_running = false;
+    u32 leaks = sd_tester_heap_leaks();
+    sd_tester_heap_dump();
+    if (leaks) {
+      static char leak_buf[128];
+      s_printf(leak_buf,
+               "#FF3300 Heap leak:# %d allocations still live\n"
+               "See " HEAP_DUMP_FILE,
+               leaks);
+      display_report_gui(leak_buf);
+      return LV_RES_INV;
+    }
+  }
+#endif
+
   create_main_menu();
   return LV_RES_INV;
 }
 
-// Display results in a message box
-static void display_results_gui(test_mode_t mode, sd_test_result_t *seq,
-                                sd_test_result_t *btf) {
+// Show a recolored text report in a message box over a dark background
+static void display_report_gui_ex(const char *text, const char **btns,
+                                  lv_btnm_action_t action) {
   // Create dark background
   lv_obj_t *dark_bg = lv_obj_create(lv_scr_act(), NULL);
   lv_obj_set_size(dark_bg, LV_HOR_RES, LV_VER_RES);
@@ -100,19 +177,66 @@ static void display_results_gui(test_mode_t mode, sd_test_result_t *seq,
   lv_obj_set_style(dark_bg, &darken_style);
 
   // Create message box
-  static const char *mbox_btns[] = {"OK", ""};
   lv_obj_t *mbox = lv_mbox_create(dark_bg, NULL);
   lv_mbox_set_recolor(mbox, true);
 
+  lv_mbox_set_text(mbox, text);
+  lv_mbox_add_btns(mbox, btns, action);
+  lv_obj_set_width(mbox, LV_HOR_RES * 2 / 3);
+  lv_obj_align(mbox, NULL, LV_ALIGN_CENTER, 0, 0);
+}
+
+static void display_report_gui(const char *text) {
+  static const char *mbox_btns[] = {"OK", ""};
+  display_report_gui_ex(text, mbox_btns, mbox_action);
+}
+
+// Init time per step for reports, steps under 1 ms are left out
+static char *report_init_summary(char *p) {
+  sd_init_prof_t *prof = sd_tester_get_init_prof();
+  const char *sep = "";
+
+  s_printf(p, "Card init: %d ms\n", prof->total_us / 1000);
+  p += strlen(p);
+
+  for (u32 i = 0; i < SD_INIT_STEP_EXT_REGS; i++) {
+    if (prof->time_us[i] < 1000 && !prof->retries[i])
+      continue;
+
+    s_printf(p, "%s%s %d ms", sep, sd_tester_get_init_step_string(i),
+             prof->time_us[i] / 1000);
+    p += strlen(p);
+    if (prof->retries[i]) {
+      s_printf(p, " #FFBA00 (%d retries)#", prof->retries[i]);
+      p += strlen(p);
+    }
+    sep = " | ";
+  }
+
+  s_printf(p, "\n\n");
+  return p + strlen(p);
+}
+
+// Display results in a message box
+// gui_pm is the share of the test time spent outside of reads, per mille
+static void display_results_gui(test_mode_t mode, sd_test_result_t *seq,
+                                sd_test_result_t *btf, bool cancelled,
+                                u32 gui_pm) {
   char result_buf[1024];
   char *p = result_buf;
 
-  s_printf(p, "#00CCFF SD Card Test Results#\n\n");
+  test_dev_t dev = sd_tester_get_device();
+  s_printf(p, "#00CCFF %s Test Results#\n\n",
+           dev == TEST_DEV_SD ? "SD Card" : sd_tester_get_device_string(dev));
   p += strlen(p);
 
+  if (cancelled) {
+    s_printf(p, "#FFDD00 Cancelled, partial results#\n\n");
+    p += strlen(p);
+  }
+
   // Sequential results
-  if (mode == TEST_SEQ_FAST || mode == TEST_SEQ_FULL || mode == TEST_ALL_FAST ||
-      mode == TEST_ALL_FULL) {
+  if (seq) {
     u32 avg = sd_tester_get_avg_latency(seq);
     s_printf(p, "#FFBA00 Sequential Read Test#\n");
     p += strlen(p);
@@ -128,8 +252,7 @@ static void display_results_gui(test_mode_t mode, sd_test_result_t *seq,
   }
 
   // Butterfly results
-  if (mode == TEST_BTF_FAST || mode == TEST_BTF_FULL || mode == TEST_ALL_FAST ||
-      mode == TEST_ALL_FULL) {
+  if (btf) {
     u32 avg = sd_tester_get_avg_latency(btf);
     s_printf(p, "#FFBA00 Butterfly Read Test#\n");
     p += strlen(p);
@@ -144,6 +267,14 @@ static void display_results_gui(test_mode_t mode, sd_test_result_t *seq,
     p += strlen(p);
   }
 
+  s_printf(p, "%sGUI overhead: %d.%d%% of test time%s\n\n",
+           gui_pm > 20 ? "#FFBA00 " : "", gui_pm / 10, gui_pm % 10,
+           gui_pm > 20 ? "#" : "");
+  p += strlen(p);
+
+  if (dev == TEST_DEV_SD)
+    p = report_init_summary(p);
+
   // Overall result
   int passed = 1;
   u32 total_errors = 0;
@@ -159,19 +290,1288 @@ static void display_results_gui(test_mode_t mode, sd_test_result_t *seq,
   }
 
   if (passed) {
-    s_printf(p, "#96FF00 [PASSED]# SD card passed all tests!");
+    s_printf(p, "#96FF00 [PASSED]# %s passed all tests!",
+             dev == TEST_DEV_SD ? "SD card" : "eMMC");
   } else {
     s_printf(p, "#FF0000 [FAILED]# %d read errors detected!", total_errors);
   }
 
-  lv_mbox_set_text(mbox, result_buf);
-  lv_mbox_add_btns(mbox, mbox_btns, mbox_action);
-  lv_obj_set_width(mbox, LV_HOR_RES * 2 / 3);
-  lv_obj_align(mbox, NULL, LV_ALIGN_CENTER, 0, 0);
+  display_report_gui(result_buf);
+}
+
+// Append one random I/O pass to a report
+static char *report_random_qd(char *p, sd_qd_result_t *res) {
+  s_printf(p, "QD%d: %d IOPS (%d KB/s) | Errors: %d\n", res->queue_depth,
+           sd_tester_get_iops(res),
+           sd_tester_get_iops(res) * RANDOM_IO_SECTORS / 2,
+           res->io.read_errors);
+  p += strlen(p);
+  s_printf(p, "Latency: Min %d / Max %d / Avg %d us\n\n",
+           res->io.min_latency_us == 0xFFFFFFFF ? 0 : res->io.min_latency_us,
+           res->io.max_latency_us, sd_tester_get_avg_latency(&res->io));
+  p += strlen(p);
+  return p;
+}
+
+// Random 4K reads at QD1, then at the card's command queue depth
+static void run_random_qd_gui(void) {
+  char result_buf[1024];
+  char *p = result_buf;
+  sd_qd_result_t qd1, qdn;
+
+  s_printf(p, "#00CCFF Random 4K Read Test (%s)#\n\n",
+           sd_tester_get_device_string(sd_tester_get_device()));
+  p += strlen(p);
+  io_progress_name = "Random 4K";
+
+  if (sd_tester_run_random_qd(&qd1, RANDOM_IO_COUNT, 1, gui_io_progress)) {
+    s_printf(p, "#FF0000 [FAILED]# Failed to allocate the read buffer.");
+    display_report_gui(result_buf);
+    return;
+  }
+  p = report_random_qd(p, &qd1);
+
+  // -2 skips the queued pass, any other error fails it
+  lv_bar_set_value(progress_bar, 0);
+  int res = sd_tester_run_random_qd(&qdn, RANDOM_IO_COUNT, SD_CMDQ_DEPTH_MAX,
+                                    gui_io_progress);
+  if (res == -2) {
+    s_printf(p, "#FFBA00 Command queueing not supported by this device#\n");
+    p += strlen(p);
+  } else if (res) {
+    s_printf(p, "#FF0000 Failed to allocate the read buffer#\n");
+    p += strlen(p);
+  } else {
+    p = report_random_qd(p, &qdn);
+  }
+
+  if (res && res != -2)
+    s_printf(p, "#FF0000 [FAILED]# Queued pass did not run.");
+  else if (!qd1.io.read_errors && (res || !qdn.io.read_errors))
+    s_printf(p, "#96FF00 [PASSED]# No read errors.");
+  else
+    s_printf(p, "#FF0000 [FAILED]# Read errors detected!");
+
+  display_report_gui(result_buf);
+}
+
+// Sequential writes with the card cache off, on, and on including the flush
+static void run_write_cache_gui(void) {
+  char result_buf[1024];
+  char *p = result_buf;
+  sd_cache_result_t res;
+
+  io_progress_name = "Write";
+  int err = sd_tester_run_write_cache(&res, gui_io_progress);
+
+  s_printf(p, "#00CCFF Write Cache Test (%d MB)#\n\n", res.sectors / 2048);
+  p += strlen(p);
+
+  if (err == -3) {
+    s_printf(p, "#FF0000 Not enough contiguous free space!#");
+    display_report_gui(result_buf);
+    return;
+  } else if (err == -4) {
+    s_printf(p, "#FF0000 Failed to erase the scratch range, not measured!#");
+    display_report_gui(result_buf);
+    return;
+  } else if (err) {
+    s_printf(p, "#FF0000 Failed to create scratch file!#");
+    display_report_gui(result_buf);
+    return;
+  }
+
+  s_printf(p, "Cache off: %d KB/s | Max latency: %d us\n",
+           sd_tester_get_kbps(res.sectors, res.nocache_us),
+           res.nocache.max_latency_us);
+  p += strlen(p);
+
+  if (!res.cache_supported) {
+    s_printf(p, "#FFBA00 Card has no volatile cache#\n\n");
+    p += strlen(p);
+  } else {
+    s_printf(p, "Cache on: %d KB/s | Max latency: %d us\n",
+             sd_tester_get_kbps(res.sectors, res.cache_us),
+             res.cache.max_latency_us);
+    p += strlen(p);
+    s_printf(p, "Cache on + flush: %d KB/s | Flush: %d us\n\n",
+             sd_tester_get_kbps(res.sectors, res.cache_us + res.flush_us),
+             res.flush_us);
+    p += strlen(p);
+  }
+
+  u32 errors = res.nocache.write_errors + res.cache.write_errors;
+  if (!errors)
+    s_printf(p, "#96FF00 [PASSED]# No write errors.");
+  else
+    s_printf(p, "#FF0000 [FAILED]# %d write errors detected!", errors);
+
+  display_report_gui(result_buf);
+}
+
+// AU sized erase and discard over a scratch range
+static void run_erase_gui(void) {
+  char result_buf[1024];
+  char *p = result_buf;
+  sd_erase_result_t res;
+
+  io_progress_name = "Erase";
+  int err = sd_tester_run_erase(&res, gui_io_progress);
+
+  s_printf(p, "#00CCFF Erase Test (%d MB, AU %d KB)#\n\n", res.sectors / 2048,
+           res.au_sectors / 2);
+  p += strlen(p);
+
+  if (err == -2) {
+    s_printf(p, "#FFBA00 Card does not support erase commands#");
+    display_report_gui(result_buf);
+    return;
+  } else if (err == -3) {
+    s_printf(p, "#FF0000 Not enough contiguous free space!#");
+    display_report_gui(result_buf);
+    return;
+  } else if (err) {
+    s_printf(p, "#FF0000 Failed to create scratch file!#");
+    display_report_gui(result_buf);
+    return;
+  }
+
+  s_printf(p, "Erase: %d MB/s | Avg/AU: %d us | Max/AU: %d us\n",
+           sd_tester_get_kbps(res.sectors, res.erase_us) / 1024,
+           sd_tester_get_avg_latency(&res.erase), res.erase.max_latency_us);
+  p += strlen(p);
+
+  if (!res.discard_supported) {
+    s_printf(p, "#FFBA00 Card does not support discard#\n\n");
+    p += strlen(p);
+  } else {
+    s_printf(p, "Discard: %d MB/s | Avg/AU: %d us | Max/AU: %d us\n\n",
+             sd_tester_get_kbps(res.sectors, res.discard_us) / 1024,
+             sd_tester_get_avg_latency(&res.discard),
+             res.discard.max_latency_us);
+    p += strlen(p);
+  }
+
+  u32 errors = res.erase.write_errors + res.discard.write_errors;
+  if (!errors)
+    s_printf(p, "#96FF00 [PASSED]# No erase errors.");
+  else
+    s_printf(p, "#FF0000 [FAILED]# %d erase errors detected!", errors);
+
+  display_report_gui(result_buf);
+}
+
+static char *report_trace_phase(char *p, const char *name,
+                                sd_trace_phase_t *phase) {
+  s_printf(p, "#FFBA00 %s# (%d I/Os, max %d us)\n", name, phase->ios,
+           phase->max_total_us);
+  p += strlen(p);
+  s_printf(p, "Issue: %d | Response: %d | Data: %d | Busy: %d | Total: %d us\n",
+           phase->issue_us, phase->response_us, phase->data_us,
+           phase->busy_us, phase->total_us);
+  p += strlen(p);
+
+  // Tracing cost against the same workload with tracing stopped
+  s32 overhead = phase->untraced_us
+                     ? ((s32)phase->traced_us - (s32)phase->untraced_us) *
+                           1000 / (s32)phase->untraced_us
+                     : 0;
+  u32 mag = overhead < 0 ? -overhead : overhead;
+  s_printf(p, "Trace overhead: %s%d.%d%% (%d vs %d ms)\n\n",
+           overhead < 0 ? "-" : "", mag / 10, mag % 10,
+           phase->traced_us / 1000, phase->untraced_us / 1000);
+  return p + strlen(p);
+}
+
+// Average latency per driver phase for sequential and random reads
+static void run_trace_gui(void) {
+  char result_buf[1024];
+  char *p = result_buf;
+  sd_trace_result_t res;
+
+  io_progress_name = "Trace";
+  int err = sd_tester_run_trace(&res, gui_io_progress);
+
+  s_printf(p, "#00CCFF Driver Trace#\n\n");
+  p += strlen(p);
+
+  if (err == -2) {
+    s_printf(p, "#FFBA00 Tracing not compiled in (build with SDMMC_TRACE=1)#");
+    display_report_gui(result_buf);
+    return;
+  } else if (err) {
+    s_printf(p, "#FF0000 Memory allocation failed!#");
+    display_report_gui(result_buf);
+    return;
+  }
+
+  p = report_trace_phase(p, "Sequential 64K", &res.seq);
+  p = report_trace_phase(p, "Random 4K", &res.rnd);
+
+  if (res.seq.dropped || res.rnd.dropped)
+    s_printf(p, "#FFBA00 Trace buffer wrapped, oldest records dropped#");
+
+  display_report_gui(result_buf);
+}
+
+// Eye map, one char per tap: pass '+', marginal '~', fail '-', tuned 'T'
+static char *report_tap_map(char *p, sd_tap_scan_result_t *res) {
+  for (u32 row = 0; row < TAP_SCAN_TAPS; row += 32) {
+    s_printf(p, "%3d ", row);
+    p += strlen(p);
+
+    for (u32 tap = row; tap < row + 32; tap++) {
+      sd_tap_result_t *t = &res->taps[tap];
+      const char *cell;
+
+      if (tap == res->tuned_tap)
+        cell = "#00CCFF T#";
+      else if (!t->errors)
+        cell = "#96FF00 +#";
+      else if (t->errors < t->reads)
+        cell = "#FFBA00 ~#";
+      else
+        cell = "#FF0000 -#";
+
+      strcpy(p, cell);
+      p += strlen(p);
+    }
+
+    *p++ = '\n';
+  }
+
+  *p++ = '\n';
+  *p = 0;
+  return p;
+}
+
+// Error rate and throughput for every 16 taps
+static char *report_tap_table(char *p, sd_tap_scan_result_t *res) {
+  for (u32 group = 0; group < TAP_SCAN_TAPS; group += 16) {
+    u32 reads = 0, errors = 0, crc = 0, kbps = 0, passed = 0;
+
+    for (u32 tap = group; tap < group + 16; tap++) {
+      sd_tap_result_t *t = &res->taps[tap];
+      reads += t->reads;
+      errors += t->errors;
+      crc += t->crc_errors;
+      if (t->kbps) {
+        kbps += t->kbps;
+        passed++;
+      }
+    }
+
+    s_printf(p, "Taps %3d-%3d: errors %d/%d (CRC %d) | %d KB/s\n", group,
+             group + 15, errors, reads, crc, passed ? kbps / passed : 0);
+    p += strlen(p);
+  }
+
+  return p;
+}
+
+// Read pass/fail over every sampling tap at the current bus mode
+static void run_tap_scan_gui(void) {
+  char result_buf[2048];
+  char *p = result_buf;
+  sd_tap_scan_result_t res;
+
+  io_progress_name = "Tap";
+  int err = sd_tester_run_tap_scan(&res, gui_io_progress);
+
+  s_printf(p, "#00CCFF Tuning Window Scan (%s)#\n\n",
+           sd_tester_get_speed_mode_string(res.mode));
+  p += strlen(p);
+
+  if (err == -2) {
+    s_printf(p, "#FFBA00 Card is not running in SDR104 or SDR50#");
+    display_report_gui(result_buf);
+    return;
+  } else if (err) {
+    s_printf(p, "#FF0000 Memory allocation failed!#");
+    display_report_gui(result_buf);
+    return;
+  }
+
+  p = report_tap_map(p, &res);
+  p = report_tap_table(p, &res);
+
+  s_printf(p, "\nWindow: taps %d-%d (%d wide) | Tuned tap: %d\n\n",
+           res.win_start, res.win_start + res.win_size - 1, res.win_size,
+           res.tuned_tap);
+  p += strlen(p);
+
+  if (res.win_size >= TAP_SCAN_TAPS / 4)
+    s_printf(p, "#96FF00 [PASSED]# Sampling window is wide.");
+  else if (res.win_size)
+    s_printf(p, "#FFBA00 [MARGINAL]# Narrow window, speed downgrades likely.");
+  else
+    s_printf(p, "#FF0000 [FAILED]# No error free tap found!");
+
+  display_report_gui(result_buf);
+}
+
+// Time and retries of every SD init step
+static void run_init_prof_gui(void) {
+  char result_buf[1024];
+  char *p = result_buf;
+  sd_init_prof_t *prof = sd_tester_get_init_prof();
+  u16 *errors = sd_get_error_count();
+
+  s_printf(p, "#00CCFF SD Init Profile#\n\n");
+  p += strlen(p);
+
+  for (u32 i = 0; i < SD_INIT_STEP_MAX; i++) {
+    if (i == SD_INIT_STEP_EXT_REGS) {
+      s_printf(p, "\n");
+      p += strlen(p);
+    }
+
+    s_printf(p, "%s: %d us", sd_tester_get_init_step_string(i),
+             prof->time_us[i]);
+    p += strlen(p);
+    if (i == SD_INIT_STEP_TUNING && prof->tuning_cmds) {
+      s_printf(p, " (%d tuning blocks)", prof->tuning_cmds);
+      p += strlen(p);
+    }
+    if (prof->retries[i]) {
+      s_printf(p, " #FFBA00 (%d retries)#", prof->retries[i]);
+      p += strlen(p);
+    }
+    s_printf(p, "\n");
+    p += strlen(p);
+  }
+
+  s_printf(p, "\nTotal: %d ms | Failed inits: %d\n", prof->total_us / 1000,
+           errors[SD_ERROR_INIT_FAIL]);
+  p += strlen(p);
+
+  if (sd_storage.bus_cfg_cached)
+    s_printf(p, "#96FF00 Tuning restored from cache#");
+
+  display_report_gui(result_buf);
+}
+
+static const char *drv_type_strings[] = {"B", "A", "C", "D"};
+static const char *pwr_limit_strings[] = {"0.72W", "1.44W", "2.16W", "2.88W"};
+
+// Best setting of the last sweep, applied when Save is pressed
+static sd_drive_sweep_result_t drive_sweep;
+
+static lv_res_t drive_sweep_mbox_action(lv_obj_t *mbox, const char *txt) {
+  if (!strcmp(txt, "Save"))
+    sd_tester_apply_drive(drive_sweep.best_drv_type,
+                          drive_sweep.best_pwr_limit, 1);
+
+  return mbox_action(mbox, txt);
+}
+
+// Throughput per driver type and power limit, best stable one can be saved
+static void run_drive_sweep_gui(void) {
+  static const char *save_btns[] = {"Save", "OK", ""};
+  char result_buf[1536];
+  char *p = result_buf;
+  sd_drive_sweep_result_t *res = &drive_sweep;
+
+  io_progress_name = "Setting";
+  int err = sd_tester_run_drive_sweep(res, gui_io_progress);
+
+  s_printf(p, "#00CCFF Driver Type / Power Limit Sweep#\n\n");
+  p += strlen(p);
+
+  if (err == -2) {
+    s_printf(p, "#FFBA00 Card is not running in a tuned UHS mode#");
+    display_report_gui(result_buf);
+    return;
+  } else if (err) {
+    s_printf(p, "#FF0000 Memory allocation failed!#");
+    display_report_gui(result_buf);
+    return;
+  }
+
+  for (u32 drv = 0; drv < 4; drv++) {
+    s_printf(p, "Type %s:", drv_type_strings[drv]);
+    p += strlen(p);
+
+    for (u32 pwr = 0; pwr < DRIVE_SWEEP_PWR_LIMITS; pwr++) {
+      sd_drive_point_t *pt = &res->points[drv][pwr];
+
+      if (!pt->supported)
+        s_printf(p, " %s -", pwr_limit_strings[pwr]);
+      else if (!pt->applied)
+        s_printf(p, " %s #FF0000 switch failed#", pwr_limit_strings[pwr]);
+      else if (pt->errors)
+        s_printf(p, " %s #FF0000 errors#", pwr_limit_strings[pwr]);
+      else
+        s_printf(p, " %s %d KB/s", pwr_limit_strings[pwr], pt->kbps);
+      p += strlen(p);
+    }
+
+    *p++ = '\n';
+  }
+
+  s_printf(p, "\nInit selected: Type %s, %s\n",
+           drv_type_strings[res->orig_drv_type & 3],
+           pwr_limit_strings[res->orig_pwr_limit & 3]);
+  p += strlen(p);
+
+  if (!res->found) {
+    s_printf(p, "#FF0000 [FAILED]# No stable setting found!");
+    display_report_gui(result_buf);
+    return;
+  }
+
+  s_printf(p, "#96FF00 Best stable:# Type %s, %s at %d KB/s\n\n"
+              "Save applies it and caches it for this card.",
+           drv_type_strings[res->best_drv_type],
+           pwr_limit_strings[res->best_pwr_limit], res->best_kbps);
+
+  display_report_gui_ex(result_buf, save_btns, drive_sweep_mbox_action);
+}
+
+// Append one device line of the concurrent read test
+static char *report_dual_dev(char *p, const char *name,
+                             sd_dual_dev_result_t *alone,
+                             sd_dual_dev_result_t *shared) {
+  u32 alone_avg = sd_tester_get_avg_latency(&alone->io);
+  u32 shared_avg = sd_tester_get_avg_latency(&shared->io);
+
+  s_printf(p, "%s: %d -> %d KB/s | Avg %d -> %d us | Max %d us\n", name,
+           alone->kbps, shared->kbps, alone_avg, shared_avg,
+           shared->io.max_latency_us);
+  p += strlen(p);
+  return p;
+}
+
+// SD and eMMC read alone, then both at once on their own controllers
+static void run_dual_gui(void) {
+  char result_buf[1024];
+  char *p = result_buf;
+  sd_dual_result_t res;
+
+  io_progress_name = "Read";
+  int err = sd_tester_run_dual(&res, gui_io_progress);
+
+  s_printf(p, "#00CCFF Concurrent SD + eMMC Read Test (%d MB each)#\n\n",
+           res.reads * BLOCKS_PER_READ / 2048);
+  p += strlen(p);
+
+  if (err == -2) {
+    s_printf(p, "#FF0000 eMMC init failed!#");
+    display_report_gui(result_buf);
+    return;
+  } else if (err == -3) {
+    s_printf(p, "#FF0000 SD card is too small!#");
+    display_report_gui(result_buf);
+    return;
+  } else if (err) {
+    s_printf(p, "#FF0000 Memory allocation failed!#");
+    display_report_gui(result_buf);
+    return;
+  }
+
+  s_printf(p, "Alone -> concurrent:\n");
+  p += strlen(p);
+  p = report_dual_dev(p, "SD", &res.sd_alone, &res.sd_shared);
+  p = report_dual_dev(p, "eMMC", &res.emmc_alone, &res.emmc_shared);
+
+  u32 alone_sum = res.sd_alone.kbps + res.emmc_alone.kbps;
+  s_printf(p, "\nAggregate: %d KB/s (%d%% of both alone)\n\n",
+           res.aggregate_kbps,
+           alone_sum ? res.aggregate_kbps * 100 / alone_sum : 0);
+  p += strlen(p);
+
+  u32 errors = res.sd_alone.io.read_errors + res.emmc_alone.io.read_errors +
+               res.sd_shared.io.read_errors + res.emmc_shared.io.read_errors;
+  if (!errors)
+    s_printf(p, "#96FF00 [PASSED]# No read errors.");
+  else
+    s_printf(p, "#FF0000 [FAILED]# %d read errors detected!", errors);
+
+  display_report_gui(result_buf);
+}
+
+// Life time estimate in 10% steps of the rated erase cycles
+static char *report_emmc_life(char *p, const char *name, u8 est) {
+  if (!est)
+    s_printf(p, "%s: not reported\n", name);
+  else if (est > 0x0A)
+    s_printf(p, "%s: #FF0000 exceeded#\n", name);
+  else
+    s_printf(p, "%s: %s%d-%d%% used%s\n", name, est >= 0x09 ? "#FFBA00 " : "",
+             (est - 1) * 10, est * 10, est >= 0x09 ? "#" : "");
+  return p + strlen(p);
+}
+
+// eMMC identification and EXT_CSD wear indicators
+static void run_emmc_health_gui(void) {
+  static const char *pre_eol_strings[] = {"not reported", "Normal",
+                                          "#FFBA00 Warning (80% of reserved "
+                                          "blocks used)#",
+                                          "#FF0000 Urgent#"};
+  char result_buf[1024];
+  char *p = result_buf;
+  sd_emmc_health_t h;
+
+  s_printf(p, "#00CCFF eMMC Health#\n\n");
+  p += strlen(p);
+
+  if (!sd_tester_get_emmc_health(&h)) {
+    s_printf(p, "#FF0000 eMMC init failed!#");
+    display_report_gui(result_buf);
+    return;
+  }
+
+  s_printf(p, "Model: %s (MID %02X) | %d GB | %s\n", h.prod_name, h.manfid,
+           h.capacity_mb / 1024, h.speed_mode);
+  p += strlen(p);
+  s_printf(p, "EXT_CSD rev %d | Boot: 2x %d KB | Cache: %d KB\n\n",
+           h.ext_csd_rev, h.boot_kb, h.cache_kb);
+  p += strlen(p);
+
+  p = report_emmc_life(p, "Life time (type A)", h.life_est_a);
+  p = report_emmc_life(p, "Life time (type B)", h.life_est_b);
+  s_printf(p, "Pre-EOL: %s\n\n", pre_eol_strings[h.pre_eol & 3]);
+  p += strlen(p);
+
+  if (h.pre_eol >= 3 || h.life_est_a > 0x0A || h.life_est_b > 0x0A)
+    s_printf(p, "#FF0000 [FAILED]# eMMC is worn out!");
+  else if (h.pre_eol == 2 || h.life_est_a >= 0x09 || h.life_est_b >= 0x09)
+    s_printf(p, "#FFBA00 [WARNING]# eMMC is near end of life.");
+  else
+    s_printf(p, "#96FF00 [PASSED]# eMMC wear is within limits.");
+
+  display_report_gui(result_buf);
+}
+
+// Decrypt only throughput, from the raw and raw + XTS read times
+static u32 bis_xts_only_kbps(u32 raw_kbps, u32 xts_kbps) {
+  if (!xts_kbps || xts_kbps >= raw_kbps)
+    return 0;
+  return (u32)((u64)raw_kbps * xts_kbps / (raw_kbps - xts_kbps));
+}
+
+// emuMMC SYSTEM reads: raw SD, after XTS decryption and through the cache
+static void run_bis_gui(void) {
+  static const char *path_strings[BIS_PATH_MAX] = {"Raw SD", "XTS",
+                                                   "XTS + cache"};
+  char result_buf[1536];
+  char *p = result_buf;
+  sd_bis_result_t res;
+
+  io_progress_name = "emuMMC";
+  int err = sd_tester_run_bis(&res, gui_io_progress);
+
+  s_printf(p, "#00CCFF emuMMC BIS Read Test#\n\n");
+  p += strlen(p);
+
+  if (err == -2) {
+    s_printf(p, "#FFBA00 No usable emuMMC found#\n"
+                "Needs an enabled raw partition emuMMC, or a file based one "
+                "on exFAT.");
+    display_report_gui(result_buf);
+    return;
+  } else if (err) {
+    s_printf(p, "#FF0000 Memory allocation failed!#");
+    display_report_gui(result_buf);
+    return;
+  }
+
+  s_printf(p, "%s emuMMC at sector 0x%X, SYSTEM %d MB\n\n",
+           res.file_based ? "File based" : "Partition", res.gpp_sector,
+           res.sectors / 2048);
+  p += strlen(p);
+
+  u32 errors = 0;
+  for (u32 path = 0; path < BIS_PATH_MAX; path++) {
+    sd_bis_pass_t *seq = &res.pass[path][BIS_PAT_SEQ];
+    sd_bis_pass_t *rnd = &res.pass[path][BIS_PAT_RND];
+
+    s_printf(p, "%s: Seq 64K %d KB/s | Rnd 4K %d KB/s\n", path_strings[path],
+             seq->kbps, rnd->kbps);
+    p += strlen(p);
+    errors += seq->errors + rnd->errors;
+  }
+
+  for (u32 pat = 0; pat < BIS_PAT_MAX; pat++) {
+    sd_bis_pass_t *c = &res.pass[BIS_PATH_CACHED][pat];
+    s_printf(p, "Cache %s: %d hits / %d misses / %d evictions\n",
+             pat == BIS_PAT_SEQ ? "seq" : "rnd", c->hits, c->misses,
+             c->evictions);
+    p += strlen(p);
+  }
+
+  sd_bis_pass_t *rp = &res.replay;
+  u32 lookups = rp->hits + rp->misses;
+  if (lookups)
+    s_printf(p, "Replay (80%% hot %d MB, %d MB span, 16 MB cache): %d KB/s\n"
+                "  %d%% hit rate, %d evictions\n",
+             res.replay_hot_mb, res.replay_mb, rp->kbps,
+             rp->hits * 100 / lookups, rp->evictions);
+  else
+    s_printf(p, "Replay: skipped, SYSTEM span too small\n");
+  p += strlen(p);
+  errors += rp->errors;
+
+  u32 raw = res.pass[BIS_PATH_RAW][BIS_PAT_SEQ].kbps;
+  u32 xts = bis_xts_only_kbps(raw, res.pass[BIS_PATH_XTS][BIS_PAT_SEQ].kbps);
+  if (xts) {
+    s_printf(p, "\nSE AES-XTS alone: ~%d KB/s. %s is the bottleneck.\n\n",
+             xts, xts < raw ? "Crypto engine" : "SD card");
+  } else {
+    s_printf(p, "\nDecryption cost is within measurement noise.\n\n");
+  }
+  p += strlen(p);
+
+  if (!errors)
+    s_printf(p, "#96FF00 [PASSED]# No read errors.");
+  else
+    s_printf(p, "#FF0000 [FAILED]# %d read errors detected!", errors);
+
+  display_report_gui(result_buf);
+}
+
+// CCPLEX worker offload: BPMP vs Cortex-A57 throughput per compute stage
+static void run_worker_gui(void) {
+  static const char *op_strings[WORKER_BENCH_MAX] = {
+      "Pattern fill", "Pattern verify", "CRC32", "Histogram merge"};
+  char result_buf[1024];
+  char *p = result_buf;
+  sd_worker_result_t res;
+
+  io_progress_name = "CCPLEX";
+  int err = sd_tester_run_worker(&res, gui_io_progress);
+
+  s_printf(p, "#00CCFF CCPLEX Worker#\n\n");
+  p += strlen(p);
+
+  if (err == -2) {
+    s_printf(p, "#FFBA00 No worker image#\n"
+                "Build it with make worker and copy output/worker.bin to "
+                WORKER_FILE ".");
+    display_report_gui(result_buf);
+    return;
+  } else if (err == -4) {
+    s_printf(p, "#FF0000 Worker did not start on the CCPLEX!#");
+    display_report_gui(result_buf);
+    return;
+  } else if (err) {
+    s_printf(p, "#FF0000 Memory allocation failed!#");
+    display_report_gui(result_buf);
+    return;
+  }
+
+  for (u32 op = 0; op < WORKER_BENCH_MAX; op++) {
+    u32 bpmp = res.bpmp_kbps[op], ccplex = res.ccplex_kbps[op];
+    u32 speedup = bpmp ? ccplex * 10 / bpmp : 0;
+    s_printf(p, "%s: BPMP %d KB/s | CCPLEX %d KB/s (x%d.%d)\n",
+             op_strings[op], bpmp, ccplex, speedup / 10, speedup % 10);
+    p += strlen(p);
+  }
+
+  s_printf(p, "\n%d MB per stage, including ring round trips and cache "
+              "maintenance.\n\n",
+           WORKER_BENCH_SIZE * WORKER_BENCH_PASSES >> 20);
+  p += strlen(p);
+
+  if (!res.mismatches && res.crc_match)
+    s_printf(p, "#96FF00 [PASSED]# Both cores agree on patterns, CRC32 and "
+                "merged bins.");
+  else
+    s_printf(p, "#FF0000 [FAILED]# %d words or bins differ, CRC32 %s.",
+             res.mismatches, res.crc_match ? "matches" : "differs");
+
+  display_report_gui(result_buf);
+}
+
+// Sequential and butterfly tests run as jobs stepped from an LV task, so the
+// Pause and Cancel buttons stay live during multi hour full tests
+static sd_job_t test_job;
+static lv_task_t *test_job_task = NULL;
+static bool test_job_paused = false;
+static test_mode_t test_job_mode;
+static sd_test_result_t test_seq_result, test_btf_result;
+static u32 test_job_step_us; // Job step time of the current LV task round
+
+// Read time against wall time of the job, for the GUI overhead in the report.
+// A round is counted from one step start to the next, paused time is not
+static u64 test_job_busy_us, test_job_wall_us;
+static u32 test_job_last_us, test_job_last_step_us;
+
+// Display frame stats, shown while a job runs. Frames are counted per LVGL
+// refresh, GUI time is LV task handler time outside of job steps, so it is the
+// time the I/O loop stalls for the display. Sync is the wait for the last flip
+// plus the copy of its areas into the back buffer
+typedef struct _frame_stats_t {
+  u32 frames;
+  u32 gui_us;
+  u32 sync_us;
+} frame_stats_t;
+
+static frame_stats_t frame_stats, frame_stats_last;
+static u32 frame_stats_last_us;
+static lv_obj_t *frame_label = NULL;
+
+#ifdef GUI_REFR_MONITOR
+// Render monitor: render time, redrawn pixels, flush time and areas of every
+// LVGL refresh. Shown as an overlay and logged per job test with the share of
+// the test wall time spent in the GUI
+typedef struct _refr_frame_t {
+  u32 time_ms; // Since test start
+  u32 px;
+  u32 flush_us;
+  u16 render_ms;
+  u8 areas;  // Flushed
+  u8 joined; // Merged into other areas before drawing
+} refr_frame_t;
+
+typedef struct _refr_stats_t {
+  u32 frames;
+  u32 render_ms;
+  u32 flush_us;
+  u64 px;
+  u32 areas;
+  u32 joined;
+} refr_stats_t;
+
+static refr_frame_t refr_cur;
+static refr_stats_t refr_stats;
+static refr_frame_t *refr_log = NULL;
+static bool refr_log_active = false;
+static u32 refr_log_cnt;
+static u32 refr_test_us, refr_test_gui_us;
+static refr_stats_t refr_test_stats;
+static lv_obj_t *refr_label;
+
+static void refr_monitor_frame(u32 time_ms, u32 px_num) {
+  refr_cur.render_ms = MIN(time_ms, 0xFFFF);
+  refr_cur.px = px_num;
+  refr_cur.joined = lv_refr_get_joined_num();
+
+  refr_stats.frames++;
+  refr_stats.render_ms += time_ms;
+  refr_stats.flush_us += refr_cur.flush_us;
+  refr_stats.px += px_num;
+  refr_stats.areas += refr_cur.areas;
+  refr_stats.joined += refr_cur.joined;
+
+  if (refr_log_active) {
+    refr_cur.time_ms = (get_tmr_us() - refr_test_us) / 1000;
+    refr_log[refr_log_cnt++ % REFR_LOG_FRAMES] = refr_cur;
+  }
+
+  memset(&refr_cur, 0, sizeof(refr_frame_t));
+}
+
+static void refr_overlay_task(void *param) {
+  static refr_stats_t last;
+  static u32 last_us, last_gui_us;
+
+  u32 now = get_tmr_us();
+  u32 frames = refr_stats.frames - last.frames;
+  u32 gui_pct = (u64)(frame_stats.gui_us - last_gui_us) * 100 /
+                MAX(now - last_us, 1);
+
+  char buf[128];
+  if (frames)
+    s_printf(buf, "Render %d ms | Flush %d us | %d px | Areas %d, %d joined "
+                  "| GUI %d%%",
+             (refr_stats.render_ms - last.render_ms) / frames,
+             (refr_stats.flush_us - last.flush_us) / frames,
+             (u32)((refr_stats.px - last.px) / frames),
+             (refr_stats.areas - last.areas) / frames,
+             (refr_stats.joined - last.joined) / frames, gui_pct);
+  else
+    s_printf(buf, "No frames | GUI %d%%", gui_pct);
+  lv_label_set_text(refr_label, buf);
+  lv_obj_align(refr_label, NULL, LV_ALIGN_IN_TOP_RIGHT, -LV_DPI / 8,
+               LV_DPI / 8);
+
+  last = refr_stats;
+  last_us = now;
+  last_gui_us = frame_stats.gui_us;
+}
+
+static void refr_overlay_init(void) {
+  static lv_style_t refr_style;
+  lv_style_copy(&refr_style, &lv_style_plain);
+  refr_style.text.color = LV_COLOR_HEX(0x00DDFF);
+
+  refr_label = lv_label_create(lv_layer_top(), NULL);
+  lv_obj_set_style(refr_label, &refr_style);
+  refr_overlay_task(NULL);
+  lv_task_create(refr_overlay_task, REFR_OVERLAY_MS, LV_TASK_PRIO_LOW, NULL);
+
+  // Without a log only the overlay runs
+  refr_log = malloc(REFR_LOG_FRAMES * sizeof(refr_frame_t));
+}
+
+static void refr_log_start(void) {
+  refr_log_active = refr_log != NULL;
+  refr_log_cnt = 0;
+  refr_test_us = get_tmr_us();
+  refr_test_gui_us = frame_stats.gui_us;
+  refr_test_stats = refr_stats;
+}
+
+// Worst case text sizes, every value printed as a signed 32 bit number (11
+// chars). A row is 6 of them, each followed by a space or the newline
+#define REFR_LOG_HDR_MAX 512
+#define REFR_LOG_ROW_MAX (6 * 12)
+
+// Writes the test summary and the logged frames, oldest first
+static void refr_log_save(void) {
+  if (!refr_log_active)
+    return;
+  refr_log_active = false;
+
+  u32 wall_us = get_tmr_us() - refr_test_us;
+  u32 gui_us = frame_stats.gui_us - refr_test_gui_us;
+  refr_stats_t st = refr_stats;
+  st.frames -= refr_test_stats.frames;
+  st.render_ms -= refr_test_stats.render_ms;
+  st.flush_us -= refr_test_stats.flush_us;
+  st.px -= refr_test_stats.px;
+  st.areas -= refr_test_stats.areas;
+  st.joined -= refr_test_stats.joined;
+
+  u32 logged = MIN(refr_log_cnt, REFR_LOG_FRAMES);
+  char *buf = malloc(REFR_LOG_HDR_MAX + logged * REFR_LOG_ROW_MAX + 1);
+  if (!buf)
+    return;
+
+  char *p = buf;
+  s_printf(p, "Test wall time %d ms, GUI %d ms (%d.%d%%)\n", wall_us / 1000,
+           gui_us / 1000, (u32)((u64)gui_us * 1000 / MAX(wall_us, 1)) / 10,
+           (u32)((u64)gui_us * 1000 / MAX(wall_us, 1)) % 10);
+  p += strlen(p);
+  s_printf(p, "Frames %d, render %d ms, flush %d ms, %d KPixels, %d areas, "
+              "%d joined\n",
+           st.frames, st.render_ms, st.flush_us / 1000, (u32)(st.px / 1000),
+           st.areas, st.joined);
+  p += strlen(p);
+  if (st.frames) {
+    s_printf(p, "Per frame: render %d ms, flush %d us, %d px, GUI %d us\n",
+             st.render_ms / st.frames, st.flush_us / st.frames,
+             (u32)(st.px / st.frames), gui_us / st.frames);
+    p += strlen(p);
+  }
+  s_printf(p, "\nLast %d frames:\n    t_ms render_ms      px flush_us areas "
+              "joined\n",
+           logged);
+  p += strlen(p);
+
+  for (u32 i = refr_log_cnt - logged; i < refr_log_cnt; i++) {
+    refr_frame_t *f = &refr_log[i % REFR_LOG_FRAMES];
+    s_printf(p, "%8d %9d %7d %8d %5d %6d\n", f->time_ms, f->render_ms, f->px,
+             f->flush_us, f->areas, f->joined);
+    p += strlen(p);
+  }
+
+  f_mkdir(SCRATCH_DIR);
+  sd_save_to_file(buf, p - buf, REFR_LOG_FILE);
+  free(buf);
+}
+#endif
+
+// Live job charts: throughput min/max, latency p99/max and worst latency per
+// device slice. Fed from a fixed size trend, so long runs cost no memory
+enum { TREND_CHART_KBPS, TREND_CHART_LAT, TREND_CHART_LBA, TREND_CHARTS };
+
+static sd_trend_t test_trend;
+static u32 test_trend_serial;
+static lv_obj_t *trend_chart[TREND_CHARTS];
+static lv_obj_t *trend_label[TREND_CHARTS];
+static lv_chart_series_t *trend_kbps_min, *trend_kbps_max;
+static lv_chart_series_t *trend_p99, *trend_max, *trend_lba;
+
+// Chart values are in tenths of MB/s and ms
+static lv_coord_t trend_tenths(u32 val, u32 unit) {
+  return MIN((u64)val * 10 / unit, 32767);
+}
+
+// Sets the chart values and scales it to the largest one. Returns the scale
+static u32 trend_chart_set(lv_obj_t *chart, lv_chart_series_t *ser,
+                           lv_coord_t *values, u32 count, u32 scale) {
+  static lv_coord_t points[MAX(TREND_POINTS, TREND_LBA_POINTS)];
+
+  for (u32 i = 0; i < lv_chart_get_point_cnt(chart); i++) {
+    points[i] = i < count ? values[i] : LV_CHART_POINT_DEF;
+    if (i < count && values[i] > (s32)scale)
+      scale = values[i];
+  }
+
+  // Round up to whole units with some headroom
+  scale = (scale + scale / 8) / 10 * 10 + 10;
+  lv_chart_set_range(chart, 0, scale);
+  lv_chart_set_points(chart, ser, points);
+
+  return scale;
+}
+
+static void trend_charts_update(void) {
+  static lv_coord_t lo[TREND_POINTS], hi[TREND_POINTS];
+  char buf[64];
+
+  if (test_trend.serial == test_trend_serial)
+    return;
+  test_trend_serial = test_trend.serial;
+
+  u32 count = test_trend.count;
+  u32 point_ms = test_trend.span * TREND_INTERVAL_US / 1000;
+
+  for (u32 i = 0; i < count; i++) {
+    lo[i] = trend_tenths(test_trend.points[i].kbps_min, 1024);
+    hi[i] = trend_tenths(test_trend.points[i].kbps_max, 1024);
+  }
+  trend_chart_set(trend_chart[TREND_CHART_KBPS], trend_kbps_min, lo, count, 0);
+  u32 scale = trend_chart_set(trend_chart[TREND_CHART_KBPS], trend_kbps_max,
+                              hi, count, 0);
+  s_printf(buf, "#00CCFF Max# / #FF5050 Min# MB/s, 0 - %d, %d ms/pt",
+           scale / 10, point_ms);
+  lv_label_set_text(trend_label[TREND_CHART_KBPS], buf);
+
+  for (u32 i = 0; i < count; i++) {
+    lo[i] = trend_tenths(test_trend.points[i].p99_us, 1000);
+    hi[i] = trend_tenths(test_trend.points[i].max_us, 1000);
+  }
+  scale = trend_chart_set(trend_chart[TREND_CHART_LAT], trend_max, hi, count,
+                          0);
+  trend_chart_set(trend_chart[TREND_CHART_LAT], trend_p99, lo, count, scale);
+  s_printf(buf, "#96FF00 p99# / #FFBA00 Max# latency, 0 - %d ms",
+           scale / 10);
+  lv_label_set_text(trend_label[TREND_CHART_LAT], buf);
+
+  for (u32 i = 0; i < TREND_LBA_POINTS; i++)
+    hi[i] = test_trend.lba_max_us[i] ? trend_tenths(test_trend.lba_max_us[i],
+                                                    1000)
+                                     : LV_CHART_POINT_DEF;
+  scale = trend_chart_set(trend_chart[TREND_CHART_LBA], trend_lba, hi,
+                          TREND_LBA_POINTS, 0);
+  s_printf(buf, "Max latency by LBA, 0 - %d ms", scale / 10);
+  lv_label_set_text(trend_label[TREND_CHART_LBA], buf);
+}
+
+// Surface map, a plain object drawing its own cells. Cells that changed are
+// invalidated one by one, so LVGL only redraws those areas
+static lv_obj_t *surface_map;
+static lv_style_t surface_styles[SURFACE_CLASSES];
+
+static void surface_cell_area(u32 cell, lv_area_t *area) {
+  area->x1 = surface_map->coords.x1 + cell % SURFACE_COLS * SURFACE_PITCH;
+  area->y1 = surface_map->coords.y1 + cell / SURFACE_COLS * SURFACE_PITCH;
+  area->x2 = area->x1 + SURFACE_PITCH - 2;
+  area->y2 = area->y1 + SURFACE_PITCH - 2;
+}
+
+static bool surface_design(lv_obj_t *obj, const lv_area_t *mask,
+                           lv_design_mode_t mode) {
+  // Gaps between cells show the background
+  if (mode == LV_DESIGN_COVER_CHK)
+    return false;
+  if (mode != LV_DESIGN_DRAW_MAIN)
+    return true;
+
+  // Only the rows and columns inside the redrawn area
+  u32 col_first = MAX(mask->x1 - obj->coords.x1, 0) / SURFACE_PITCH;
+  u32 col_last = MIN((mask->x2 - obj->coords.x1) / SURFACE_PITCH,
+                     SURFACE_COLS - 1);
+  u32 row_first = MAX(mask->y1 - obj->coords.y1, 0) / SURFACE_PITCH;
+  u32 row_last = MIN((mask->y2 - obj->coords.y1) / SURFACE_PITCH,
+                     SURFACE_ROWS - 1);
+
+  for (u32 row = row_first; row <= row_last; row++) {
+    for (u32 col = col_first; col <= col_last; col++) {
+      u32 cell = row * SURFACE_COLS + col;
+      lv_area_t area;
+      surface_cell_area(cell, &area);
+      lv_draw_rect(&area, mask, &surface_styles[test_trend.surface[cell]],
+                   LV_OPA_COVER);
+    }
+  }
+
+  return true;
+}
+
+// Invalidates at most SURFACE_INV_MAX changed cells, the rest stay dirty for
+// the next update. LVGL redraws the whole screen once its area FIFO is full
+static void surface_map_update(void) {
+  u32 budget = SURFACE_INV_MAX;
+
+  for (u32 i = 0; i < SURFACE_CELLS / 32 && budget; i++) {
+    u32 dirty = test_trend.surface_dirty[i];
+
+    while (dirty && budget) {
+      u32 bit = __builtin_ctz(dirty);
+      dirty &= dirty - 1;
+      budget--;
+
+      lv_area_t area;
+      surface_cell_area(i * 32 + bit, &area);
+      lv_inv_area(&area);
+    }
+    test_trend.surface_dirty[i] = dirty;
+  }
+}
+
+static void surface_map_create(void) {
+  static const u32 colors[SURFACE_CLASSES] = {0x303030, 0x2E6B2E, 0x96FF00,
+                                              0xFFBA00, 0xFF5050, 0x3060FF};
+  for (u32 i = 0; i < SURFACE_CLASSES; i++) {
+    lv_style_copy(&surface_styles[i], &lv_style_plain);
+    surface_styles[i].body.main_color = LV_COLOR_HEX(colors[i]);
+    surface_styles[i].body.grad_color = LV_COLOR_HEX(colors[i]);
+  }
+
+  lv_obj_t *legend = lv_label_create(main_win, NULL);
+  lv_label_set_recolor(legend, true);
+  lv_label_set_text(legend, "Surface:  #2E6B2E < 1 ms#  #96FF00 < 5 ms#  "
+                            "#FFBA00 < 50 ms#  #FF5050 > 50 ms#  "
+                            "#3060FF Error#");
+
+  surface_map = lv_obj_create(main_win, NULL);
+  lv_obj_set_size(surface_map, SURFACE_COLS * SURFACE_PITCH,
+                  SURFACE_ROWS * SURFACE_PITCH);
+  lv_obj_set_design_func(surface_map, surface_design);
+  lv_obj_set_click(surface_map, false);
+}
+
+static lv_obj_t *trend_chart_create(lv_obj_t *parent, u32 idx,
+                                    lv_chart_type_t type) {
+  static lv_style_t chart_style;
+  lv_style_copy(&chart_style, &lv_style_plain);
+  chart_style.body.main_color = LV_COLOR_HEX(0x151515);
+  chart_style.body.grad_color = LV_COLOR_HEX(0x151515);
+  chart_style.body.border.color = LV_COLOR_HEX(0x404040);
+  chart_style.body.border.width = 1;
+  chart_style.line.color = LV_COLOR_HEX(0x303030);
+  chart_style.line.width = 1;
+
+  lv_obj_t *col = lv_cont_create(parent, NULL);
+  lv_cont_set_layout(col, LV_LAYOUT_COL_M);
+  lv_cont_set_fit(col, true, true);
+  lv_obj_set_style(col, lv_obj_get_style(parent));
+
+  trend_label[idx] = lv_label_create(col, NULL);
+  lv_label_set_recolor(trend_label[idx], true);
+  lv_label_set_text(trend_label[idx], "");
+
+  lv_obj_t *chart = lv_chart_create(col, NULL);
+  lv_chart_set_style(chart, &chart_style);
+  lv_obj_set_size(chart, (LV_HOR_RES - LV_DPI) / TREND_CHARTS,
+                  LV_DPI * 3 / 2);
+  lv_chart_set_type(chart, type);
+  lv_chart_set_div_line_count(chart, 3, 0);
+  lv_chart_set_series_width(chart, type == LV_CHART_TYPE_POINT ? 3 : 2);
+  lv_chart_set_point_count(chart, idx == TREND_CHART_LBA ? TREND_LBA_POINTS
+                                                         : TREND_POINTS);
+  trend_chart[idx] = chart;
+
+  return chart;
+}
+
+static void trend_charts_create(void) {
+  lv_obj_t *row = lv_cont_create(main_win, NULL);
+  lv_cont_set_layout(row, LV_LAYOUT_ROW_M);
+  lv_cont_set_fit(row, true, true);
+  lv_obj_set_style(row, lv_obj_get_style(main_win));
+
+  lv_obj_t *chart = trend_chart_create(row, TREND_CHART_KBPS,
+                                       LV_CHART_TYPE_LINE);
+  trend_kbps_max = lv_chart_add_series(chart, LV_COLOR_HEX(0x00CCFF));
+  trend_kbps_min = lv_chart_add_series(chart, LV_COLOR_HEX(0xFF5050));
+
+  chart = trend_chart_create(row, TREND_CHART_LAT, LV_CHART_TYPE_LINE);
+  trend_max = lv_chart_add_series(chart, LV_COLOR_HEX(0xFFBA00));
+  trend_p99 = lv_chart_add_series(chart, LV_COLOR_HEX(0x96FF00));
+
+  chart = trend_chart_create(row, TREND_CHART_LBA, LV_CHART_TYPE_POINT);
+  trend_lba = lv_chart_add_series(chart, LV_COLOR_HEX(0xFFBA00));
+
+  sd_tester_trend_init(&test_trend);
+  test_trend_serial = ~0;
+  trend_charts_update();
+
+  surface_map_create();
+}
+
+static void frame_stats_update(void) {
+  u32 now = get_tmr_us();
+  if (now - frame_stats_last_us < FRAME_STATS_MS * 1000)
+    return;
+
+  u32 frames = frame_stats.frames - frame_stats_last.frames;
+  if (frames) {
+    u32 frame_us = (now - frame_stats_last_us) / frames;
+    u32 stall_us = (frame_stats.gui_us - frame_stats_last.gui_us) / frames;
+    u32 sync_us = (frame_stats.sync_us - frame_stats_last.sync_us) / frames;
+
+    char buf[96];
+    s_printf(buf, "Frame %d.%d ms | I/O stall %d.%d ms per frame | Sync %d us",
+             frame_us / 1000, frame_us / 100 % 10, stall_us / 1000,
+             stall_us / 100 % 10, sync_us);
+    lv_label_set_text(frame_label, buf);
+    lv_obj_align(frame_label, NULL, LV_ALIGN_IN_BOTTOM_RIGHT, -LV_DPI / 8,
+                 -LV_DPI / 8);
+  }
+
+  frame_stats_last = frame_stats;
+  frame_stats_last_us = now;
+}
+
+static void frame_stats_create(void) {
+  static lv_style_t frame_style;
+  lv_style_copy(&frame_style, &lv_style_plain);
+  frame_style.text.color = LV_COLOR_HEX(0x909090);
+
+  frame_label = lv_label_create(lv_layer_top(), NULL);
+  lv_obj_set_style(frame_label, &frame_style);
+  lv_label_set_text(frame_label, "");
+
+  frame_stats_last = frame_stats;
+  frame_stats_last_us = get_tmr_us();
+}
+
+static void test_job_finish(bool cancelled) {
+  lv_task_del(test_job_task);
+  test_job_task = NULL;
+  lv_obj_del(frame_label);
+  frame_label = NULL;
+#ifdef GUI_REFR_MONITOR
+  refr_log_save();
+#endif
+
+  // Only report the parts that ran. Ending the job closes the last trend
+  // interval, so the charts behind the results show the whole run
+  sd_tester_job_end(&test_job);
+  trend_charts_update();
+  sd_test_result_t *seq_ptr = NULL, *btf_ptr = NULL;
+  if (test_job_mode != TEST_BTF_FAST && test_job_mode != TEST_BTF_FULL)
+    seq_ptr = &test_seq_result;
+  if (test_job.type == SD_JOB_BTF)
+    btf_ptr = &test_btf_result;
+
+  u32 gui_pm = 0;
+  if (test_job_wall_us)
+    gui_pm = (test_job_wall_us - test_job_busy_us) * 1000 / test_job_wall_us;
+  display_results_gui(test_job_mode, seq_ptr, btf_ptr, cancelled, gui_pm);
+}
+
+static void test_job_run(void *param) {
+  if (test_job_paused) {
+    test_job_last_us = 0;
+    return;
+  }
+
+  u32 start = get_tmr_us();
+  if (test_job_last_us) {
+    test_job_wall_us += start - test_job_last_us;
+    test_job_busy_us += test_job_last_step_us;
+  }
+
+  int done = sd_tester_job_step(&test_job, JOB_STEP_US);
+  test_job_step_us = get_tmr_us() - start;
+  test_job_last_us = start;
+  test_job_last_step_us = test_job_step_us;
+
+  trend_charts_update();
+  surface_map_update();
+  frame_stats_update();
+
+  if (test_job.type == SD_JOB_SEQ)
+    gui_seq_progress(test_job.pos, test_job.total, test_job.lat_low,
+                     test_seq_result.read_errors);
+  else
+    gui_btf_progress(test_job.pos, test_job.total, test_job.lat_low,
+                     test_job.lat_high);
+
+  if (!done)
+    return;
+
+  // All tests continue with butterfly after sequential
+  if (test_job.type == SD_JOB_SEQ &&
+      (test_job_mode == TEST_ALL_FAST || test_job_mode == TEST_ALL_FULL)) {
+    sd_tester_job_end(&test_job);
+    u32 iter = test_job_mode == TEST_ALL_FAST ? FAST_BUTTERFLY_ITER : 0;
+    if (!sd_tester_job_btf(&test_job, &test_btf_result, iter)) {
+      test_job.trend = &test_trend;
+      lv_bar_set_value(progress_bar, 0);
+      return;
+    }
+  }
+
+  test_job_finish(false);
+}
+
+static lv_res_t btn_job_pause(lv_obj_t *btn) {
+  test_job_paused = !test_job_paused;
+  lv_label_set_text(lv_obj_get_child(btn, NULL),
+                    test_job_paused ? "Resume" : "Pause");
+  return LV_RES_OK;
+}
+
+static lv_res_t btn_job_cancel(lv_obj_t *btn) {
+  if (test_job_task)
+    test_job_finish(true);
+  return LV_RES_OK;
+}
+
+static void test_job_start(test_mode_t mode) {
+  int res;
+
+  test_job_mode = mode;
+  test_job_paused = false;
+  test_job_busy_us = 0;
+  test_job_wall_us = 0;
+  test_job_last_us = 0;
+  memset(&test_btf_result, 0, sizeof(sd_test_result_t));
+
+  switch (mode) {
+  case TEST_SEQ_FAST:
+  case TEST_ALL_FAST:
+    res = sd_tester_job_seq(&test_job, &test_seq_result, FAST_TEST_SECTORS);
+    break;
+  case TEST_SEQ_FULL:
+  case TEST_ALL_FULL:
+    res = sd_tester_job_seq(&test_job, &test_seq_result, 0);
+    break;
+  case TEST_BTF_FAST:
+    res = sd_tester_job_btf(&test_job, &test_btf_result, FAST_BUTTERFLY_ITER);
+    break;
+  default:
+    res = sd_tester_job_btf(&test_job, &test_btf_result, 0);
+    break;
+  }
+
+  if (res) {
+    display_report_gui("#FF0000 Failed to allocate the read buffer#");
+    return;
+  }
+
+  lv_obj_t *btn_cont = lv_cont_create(main_win, NULL);
+  lv_cont_set_layout(btn_cont, LV_LAYOUT_ROW_M);
+  lv_cont_set_fit(btn_cont, true, true);
+  lv_obj_align(btn_cont, status_label, LV_ALIGN_OUT_BOTTOM_MID, 0, LV_DPI / 2);
+
+  create_btn(btn_cont, "Pause", btn_job_pause);
+  create_btn(btn_cont, "Cancel", btn_job_cancel);
+
+  trend_charts_create();
+  test_job.trend = &test_trend;
+  frame_stats_create();
+#ifdef GUI_REFR_MONITOR
+  refr_log_start();
+#endif
+
+  test_job_task = lv_task_create(test_job_run, 0, LV_TASK_PRIO_MID, NULL);
 }
 
 // Run test with GUI progress
 static void run_test_gui(test_mode_t mode) {
+#ifdef BDK_MALLOC_TRACK
+  sd_tester_heap_mark();
+  heap_test_running = true;
+#endif
+
   // Clear main window content
   lv_obj_clean(main_win);
 
@@ -201,44 +1601,40 @@ static void run_test_gui(test_mode_t mode) {
     msleep(10);
   }
 
-  // Run tests
-  sd_test_result_t seq_result = {0}, btf_result = {0};
-  sd_test_result_t *seq_ptr = NULL, *btf_ptr = NULL;
-
-  switch (mode) {
-  case TEST_SEQ_FAST:
-    sd_tester_run_sequential(&seq_result, FAST_TEST_SECTORS, gui_seq_progress);
-    seq_ptr = &seq_result;
-    break;
-  case TEST_SEQ_FULL:
-    sd_tester_run_sequential(&seq_result, 0, gui_seq_progress);
-    seq_ptr = &seq_result;
-    break;
-  case TEST_BTF_FAST:
-    sd_tester_run_butterfly(&btf_result, FAST_BUTTERFLY_ITER, gui_btf_progress);
-    btf_ptr = &btf_result;
-    break;
-  case TEST_BTF_FULL:
-    sd_tester_run_butterfly(&btf_result, 0, gui_btf_progress);
-    btf_ptr = &btf_result;
-    break;
-  case TEST_ALL_FAST:
-    sd_tester_run_sequential(&seq_result, FAST_TEST_SECTORS, gui_seq_progress);
-    lv_bar_set_value(progress_bar, 0);
-    sd_tester_run_butterfly(&btf_result, FAST_BUTTERFLY_ITER, gui_btf_progress);
-    seq_ptr = &seq_result;
-    btf_ptr = &btf_result;
-    break;
-  case TEST_ALL_FULL:
-    sd_tester_run_sequential(&seq_result, 0, gui_seq_progress);
-    lv_bar_set_value(progress_bar, 0);
-    sd_tester_run_butterfly(&btf_result, 0, gui_btf_progress);
-    seq_ptr = &seq_result;
-    btf_ptr = &btf_result;
-    break;
+  if (mode == TEST_RND_QD) {
+    run_random_qd_gui();
+    return;
+  } else if (mode == TEST_WR_CACHE) {
+    run_write_cache_gui();
+    return;
+  } else if (mode == TEST_ERASE) {
+    run_erase_gui();
+    return;
+  } else if (mode == TEST_TRACE) {
+    run_trace_gui();
+    return;
+  } else if (mode == TEST_TAP_SCAN) {
+    run_tap_scan_gui();
+    return;
+  } else if (mode == TEST_INIT_PROF) {
+    run_init_prof_gui();
+    return;
+  } else if (mode == TEST_DRIVE_SWEEP) {
+    run_drive_sweep_gui();
+    return;
+  } else if (mode == TEST_DUAL) {
+    run_dual_gui();
+    return;
+  } else if (mode == TEST_BIS) {
+    run_bis_gui();
+    return;
+  } else if (mode == TEST_WORKER) {
+    run_worker_gui();
+    return;
   }
 
-  display_results_gui(mode, seq_ptr, btf_ptr);
+  // Sequential and butterfly modes
+  test_job_start(mode);
 }
 
 // Button actions
@@ -267,6 +1663,78 @@ static lv_res_t btn_test_all_full(lv_obj_t *btn) {
   return LV_RES_OK;
 }
 
+static lv_res_t btn_test_rnd_qd(lv_obj_t *btn) {
+  run_test_gui(TEST_RND_QD);
+  return LV_RES_OK;
+}
+
+static lv_res_t btn_test_wr_cache(lv_obj_t *btn) {
+  run_test_gui(TEST_WR_CACHE);
+  return LV_RES_OK;
+}
+
+static lv_res_t btn_test_erase(lv_obj_t *btn) {
+  run_test_gui(TEST_ERASE);
+  return LV_RES_OK;
+}
+
+static lv_res_t btn_test_trace(lv_obj_t *btn) {
+  run_test_gui(TEST_TRACE);
+  return LV_RES_OK;
+}
+
+static lv_res_t btn_test_tap_scan(lv_obj_t *btn) {
+  run_test_gui(TEST_TAP_SCAN);
+  return LV_RES_OK;
+}
+
+static lv_res_t btn_test_init_prof(lv_obj_t *btn) {
+  run_test_gui(TEST_INIT_PROF);
+  return LV_RES_OK;
+}
+
+static lv_res_t btn_test_drive_sweep(lv_obj_t *btn) {
+  run_test_gui(TEST_DRIVE_SWEEP);
+  return LV_RES_OK;
+}
+
+static lv_res_t btn_test_dual(lv_obj_t *btn) {
+  run_test_gui(TEST_DUAL);
+  return LV_RES_OK;
+}
+
+static lv_res_t btn_test_bis(lv_obj_t *btn) {
+  run_test_gui(TEST_BIS);
+  return LV_RES_OK;
+}
+
+static lv_res_t btn_test_worker(lv_obj_t *btn) {
+  run_test_gui(TEST_WORKER);
+  return LV_RES_OK;
+}
+
+// Cycles the read test target through SD and the eMMC partitions
+static lv_res_t btn_device(lv_obj_t *btn) {
+  test_dev_t dev = sd_tester_get_device() + 1;
+  if (dev >= TEST_DEV_MAX)
+    dev = TEST_DEV_SD;
+
+  if (!sd_tester_set_device(dev)) {
+    sd_tester_set_device(TEST_DEV_SD);
+    create_main_menu();
+    display_report_gui("#FF0000 eMMC init failed!#");
+    return LV_RES_INV;
+  }
+
+  create_main_menu();
+  return LV_RES_INV;
+}
+
+static lv_res_t btn_emmc_health(lv_obj_t *btn) {
+  run_emmc_health_gui();
+  return LV_RES_OK;
+}
+
 static lv_res_t btn_exit(lv_obj_t *btn) {
   sd_end();
   power_set_state(POWER_OFF_REBOOT);
@@ -323,15 +1791,43 @@ static void create_main_menu(void) {
   sd_tester_get_card_info(&card_info);
 
   lv_obj_t *card_lbl = lv_label_create(main_win, NULL);
-  char card_buf[64];
-  s_printf(card_buf, "Card: %d GB (%s)", card_info.capacity_gb,
-           card_info.speed_mode);
+  char card_buf[160];
+  char *p = card_buf;
+  s_printf(p, "Card: %d GB (%s", card_info.capacity_gb, card_info.speed_mode);
+  p += strlen(p);
+  if (card_info.cmdq_depth) {
+    s_printf(p, ", CMDQ %d", card_info.cmdq_depth);
+    p += strlen(p);
+  }
+  if (card_info.bus_cfg_cached) {
+    s_printf(p, ", cached tuning");
+    p += strlen(p);
+  }
+  s_printf(p, ", init %d ms)", card_info.init_ms);
+  p += strlen(p);
+
+  test_dev_t dev = sd_tester_get_device();
+  if (dev != TEST_DEV_SD)
+    s_printf(p, "\nRead tests on %s (%d MB, read-only)",
+             sd_tester_get_device_string(dev),
+             sd_tester_get_device_sectors() / 2048);
   lv_label_set_text(card_lbl, card_buf);
 
   // Separator
   lv_obj_t *sep1 = lv_label_create(main_win, NULL);
   lv_label_set_text(sep1, "");
 
+#ifdef SD_TESTER_STUB
+  // Packed builds use the separator for the stub timings
+  const stub_info_t *stub = stub_get_info();
+  if (stub) {
+    char stub_buf[96];
+    s_printf(stub_buf, "LZ4 payload: %d KB packed, %d KB unpacked in %d us",
+             stub->packed_size >> 10, stub->raw_size >> 10, stub->unpack_us);
+    lv_label_set_text(sep1, stub_buf);
+  }
+#endif
+
   // Fast tests section
   lv_obj_t *fast_lbl = lv_label_create(main_win, NULL);
   lv_label_set_recolor(fast_lbl, true);
@@ -358,30 +1854,211 @@ static void create_main_menu(void) {
   create_btn(btn_cont2, "Butterfly Full", btn_test_btf_full);
   create_btn(btn_cont2, "All Full", btn_test_all_full);
 
-  // Exit section
+  // Performance tests section
+  lv_obj_t *perf_lbl = lv_label_create(main_win, NULL);
+  lv_label_set_recolor(perf_lbl, true);
+  lv_label_set_text(perf_lbl, "#00CCFF Performance Tests#");
+
+  lv_obj_t *btn_cont3 = lv_cont_create(main_win, NULL);
+  lv_cont_set_layout(btn_cont3, LV_LAYOUT_ROW_M);
+  lv_cont_set_fit(btn_cont3, true, true);
+
+  create_btn(btn_cont3, "Random 4K QD", btn_test_rnd_qd);
+  create_btn(btn_cont3, "Write Cache", btn_test_wr_cache);
+  create_btn(btn_cont3, "Erase", btn_test_erase);
+  create_btn(btn_cont3, "SD + eMMC", btn_test_dual);
+  create_btn(btn_cont3, "emuMMC BIS", btn_test_bis);
+
+  // Diagnostics section
+  lv_obj_t *diag_lbl = lv_label_create(main_win, NULL);
+  lv_label_set_recolor(diag_lbl, true);
+  lv_label_set_text(diag_lbl, "#00CCFF Diagnostics#");
+
+  lv_obj_t *btn_cont4 = lv_cont_create(main_win, NULL);
+  lv_cont_set_layout(btn_cont4, LV_LAYOUT_ROW_M);
+  lv_cont_set_fit(btn_cont4, true, true);
+
+  create_btn(btn_cont4, "Trace", btn_test_trace);
+  create_btn(btn_cont4, "Tap Scan", btn_test_tap_scan);
+  create_btn(btn_cont4, "Init Profile", btn_test_init_prof);
+  create_btn(btn_cont4, "Drive Sweep", btn_test_drive_sweep);
+  create_btn(btn_cont4, "CCPLEX", btn_test_worker);
+
+  // Device selection and exit section
   lv_obj_t *sep2 = lv_label_create(main_win, NULL);
   lv_label_set_text(sep2, "");
 
-  create_btn(main_win, "Exit", btn_exit);
+  lv_obj_t *btn_cont5 = lv_cont_create(main_win, NULL);
+  lv_cont_set_layout(btn_cont5, LV_LAYOUT_ROW_M);
+  lv_cont_set_fit(btn_cont5, true, true);
+
+  char dev_buf[32];
+  s_printf(dev_buf, "Device: %s", sd_tester_get_device_string(dev));
+  create_btn(btn_cont5, dev_buf, btn_device);
+  create_btn(btn_cont5, "eMMC Health", btn_emmc_health);
+  create_btn(btn_cont5, "Exit", btn_exit);
 }
 
 // LVGL display flush callback - rotates from horizontal LVGL to portrait
 // framebuffer
+static void disp_rotate(u32 *fb, int32_t x1, int32_t y1, int32_t x2,
+                        int32_t y2, const lv_color_t *color_p) {
+  rotate_area(fb, gfx_ctxt.stride, x1, y1, x2, y2, (const u32 *)color_p);
+}
+
+#ifdef GUI_VIC_FLUSH
+static bool vic_flush = false;
+
+// LVGL areas are copied unrotated into a landscape surface and the VIC
+// rotates it into the framebuffer, so the CPU only does sequential copies
+static bool disp_vic_init(void) {
+  if (vic_init()) {
+    vic_end();
+    return false;
+  }
+
+  memset((void *)NYX_FB_ADDRESS, 0, NYX_FB_SZ);
+  memset((void *)NYX_FB2_ADDRESS, 0, NYX_FB_SZ);
+
+  vic_surface_t sfc;
+  sfc.src_buf = NYX_FB2_ADDRESS;
+  sfc.dst_buf = NYX_FB_ADDRESS;
+  sfc.width = 1280;
+  sfc.height = 720;
+  sfc.pix_fmt = VIC_PIX_FORMAT_X8R8G8B8;
+  sfc.rotation = VIC_ROTATION_270;
+  vic_set_surface(&sfc);
+
+  display_init_window_a_pitch_vic();
+
+  return true;
+}
+#endif
+
+// Software flush is double buffered: areas are rotated into the back buffer
+// and the buffers flip once LVGL finishes a refresh. The flip is only armed
+// there, the hardware latches it on vblank while the I/O loop carries on, and
+// the next refresh waits for it before bringing the back buffer up to date
+static u32 *fb_front, *fb_back = NULL; // No back buffer while single buffered
+static bool fb_flip_pending = false;
+static lv_area_t fb_dirty[FLIP_DIRTY_AREAS];
+static u32 fb_dirty_cnt = 0;
+
+static void disp_double_init(void) {
+  memset((void *)NYX_FB_ADDRESS, 0, NYX_FB_SZ);
+  memset((void *)NYX_FB2_ADDRESS, 0, NYX_FB_SZ);
+
+  fb_front = (u32 *)NYX_FB_ADDRESS;
+  fb_back = (u32 *)NYX_FB2_ADDRESS;
+  display_set_framebuffer(0, fb_front);
+}
+
+// Copies the areas of the flipped frame from the front buffer, skipping the
+// ones the next area covers anyway
+static void disp_sync_back(const lv_area_t *next) {
+  if (!fb_flip_pending)
+    return;
+
+  u32 start = get_tmr_us();
+  display_wait_framebuffer(0);
+
+  u32 stride = gfx_ctxt.stride;
+  for (u32 i = 0; i < fb_dirty_cnt; i++) {
+    const lv_area_t *area = &fb_dirty[i];
+    if (lv_area_is_in(area, next))
+      continue;
+
+    // LVGL columns are framebuffer rows
+    u32 len = lv_area_get_height(area) * sizeof(u32);
+    for (int32_t x = area->x1; x <= area->x2; x++) {
+      u32 off = (1279 - x) * stride + area->y1;
+      memcpy(&fb_back[off], &fb_front[off], len);
+    }
+  }
+
+  fb_dirty_cnt = 0;
+  fb_flip_pending = false;
+  frame_stats.sync_us += get_tmr_us() - start;
+}
+
+static void disp_dirty_add(const lv_area_t *area) {
+  if (fb_dirty_cnt < FLIP_DIRTY_AREAS)
+    fb_dirty[fb_dirty_cnt++] = *area;
+  else
+    lv_area_join(&fb_dirty[FLIP_DIRTY_AREAS - 1],
+                 &fb_dirty[FLIP_DIRTY_AREAS - 1], area);
+}
+
+// LVGL refresh monitor, called once all areas of a refresh are flushed
+static void disp_monitor(uint32_t time_ms, uint32_t px_num) {
+  frame_stats.frames++;
+#ifdef GUI_REFR_MONITOR
+  refr_monitor_frame(time_ms, px_num);
+#endif
+
+  if (!fb_back)
+    return;
+
+  // Display reads from DRAM
+  bpmp_mmu_maintenance(BPMP_MMU_MAINT_CLEAN_WAY, false);
+  display_set_framebuffer(0, fb_back);
+
+  u32 *fb = fb_front;
+  fb_front = fb_back;
+  fb_back = fb;
+  fb_flip_pending = true;
+}
+
 static void disp_flush(int32_t x1, int32_t y1, int32_t x2, int32_t y2,
                        const lv_color_t *color_p) {
-  // Rotate from LVGL horizontal (1280x720) to framebuffer portrait (720x1280)
-  for (int32_t y = y1; y <= y2; y++) {
-    for (int32_t x = x1; x <= x2; x++) {
-      // Transform: LVGL(x,y) -> FB(y, 1279-x)
-      u32 fb_x = y;
-      u32 fb_y = 1279 - x;
-      gfx_ctxt.fb[fb_x + fb_y * gfx_ctxt.stride] = color_p->full;
-      color_p++;
+#ifdef GUI_VIC_FLUSH
+  if (vic_flush) {
+    u32 w = x2 - x1 + 1;
+    u32 *sfc = (u32 *)NYX_FB2_ADDRESS;
+    for (int32_t y = y1; y <= y2; y++) {
+      memcpy(&sfc[y * 1280 + x1], color_p, w * sizeof(lv_color_t));
+      color_p += w;
+    }
+
+    // VIC reads from DRAM
+    bpmp_mmu_maintenance(BPMP_MMU_MAINT_CLEAN_WAY, false);
+    if (!vic_compose()) {
+      lv_flush_ready();
+      return;
     }
+
+    // VIC hung. Go back to software rotation, the surface has the whole screen
+    vic_flush = false;
+    vic_end();
+    display_init_window_a_pitch();
+    disp_rotate(gfx_ctxt.fb, 0, 0, 1279, 719, (const lv_color_t *)sfc);
+    lv_flush_ready();
+    return;
+  }
+#endif
+
+  if (fb_back) {
+    lv_area_t area;
+    lv_area_set(&area, x1, y1, x2, y2);
+    disp_sync_back(&area);
+    disp_rotate(fb_back, x1, y1, x2, y2, color_p);
+    disp_dirty_add(&area);
+  } else {
+    disp_rotate(gfx_ctxt.fb, x1, y1, x2, y2, color_p);
   }
   lv_flush_ready();
 }
 
+#ifdef GUI_REFR_MONITOR
+static void disp_flush_timed(int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+                             const lv_color_t *color_p) {
+  u32 start = get_tmr_us();
+  disp_flush(x1, y1, x2, y2, color_p);
+  refr_cur.flush_us += get_tmr_us() - start;
+  refr_cur.areas++;
+}
+#endif
+
 // Touch input read callback for LVGL
 static bool touch_read(lv_indev_data_t *data) {
   touch_event event;
@@ -395,8 +2072,10 @@ static bool touch_read(lv_indev_data_t *data) {
 }
 
 void ipl_main(void) {
-  // Hardware initialization
+  // Hardware initialization, already done by the stub in packed builds
+#ifndef SD_TESTER_STUB
   hw_init();
+#endif
   pivot_stack(IPL_STACK_TOP);
   heap_init((void *)IPL_HEAP_START);
 
@@ -404,6 +2083,8 @@ void ipl_main(void) {
 
   // Mount SD card
   int sd_mounted = sd_mount();
+  if (sd_mounted)
+    sd_tester_sync_bus_cfg();
 
   // Initialize display
   display_init();
@@ -428,14 +2109,25 @@ void ipl_main(void) {
     power_set_state(POWER_OFF_REBOOT);
   }
 
+#ifdef GUI_VIC_FLUSH
+  vic_flush = disp_vic_init();
+  if (!vic_flush)
+#endif
+    disp_double_init();
+
   // Initialize LVGL
   lv_init();
 
   // Register display driver
   lv_disp_drv_t disp_drv;
   lv_disp_drv_init(&disp_drv);
+#ifdef GUI_REFR_MONITOR
+  disp_drv.disp_flush = disp_flush_timed;
+#else
   disp_drv.disp_flush = disp_flush;
+#endif
   lv_disp_drv_register(&disp_drv);
+  lv_refr_set_monitor_cb(disp_monitor);
 
   // Register touch input driver
   lv_indev_drv_t indev_drv;
@@ -447,9 +2139,22 @@ void ipl_main(void) {
   // Create main menu
   create_main_menu();
 
+#ifdef BDK_MALLOC_TRACK
+  heap_overlay_init();
+#endif
+#ifdef GUI_REFR_MONITOR
+  refr_overlay_init();
+#endif
+
   // Main loop
   while (1) {
+    u32 start = get_tmr_us();
+    test_job_step_us = 0;
     lv_task_handler();
-    msleep(5);
+    frame_stats.gui_us += get_tmr_us() - start - test_job_step_us;
+
+    // A running test job uses the idle time
+    if (!test_job_task || test_job_paused)
+      msleep(5);
   }
 }
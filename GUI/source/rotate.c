@@ -0,0 +1,40 @@
+/*
+ * SD Card Read Tester - Display area rotation
+ * Copyright (c) 2026
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+// Software rotation of LVGL areas into the portrait framebuffer. Kept apart
+// from main.c so tools/rotatetest can check and time it on the host.
+
+#include <utils/types.h>
+
+#include "config.h"
+#include "rotate.h"
+
+// Rotate from LVGL horizontal (1280x720) to framebuffer portrait (720x1280).
+// LVGL(x,y) -> FB(y, 1279-x), so an LVGL column is a framebuffer row. Walk
+// the area in tiles and store each tile column as a sequential FB row run,
+// the source rows of a tile stay cached meanwhile.
+void rotate_area(u32 *fb, u32 stride, s32 x1, s32 y1, s32 x2, s32 y2,
+                 const u32 *src) {
+  u32 w = x2 - x1 + 1;
+
+  for (s32 ty = y1; ty <= y2; ty += FLUSH_TILE) {
+    s32 ty2 = MIN(ty + FLUSH_TILE - 1, y2);
+    for (s32 tx = x1; tx <= x2; tx += FLUSH_TILE) {
+      s32 tx2 = MIN(tx + FLUSH_TILE - 1, x2);
+      for (s32 x = tx; x <= tx2; x++) {
+        u32 *dst = &fb[(1279 - x) * stride + ty];
+        const u32 *p = &src[(ty - y1) * w + (x - x1)];
+        for (s32 y = ty; y <= ty2; y++) {
+          *dst++ = *p;
+          p += w;
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,18 @@
+/*
+ * SD Card Read Tester - Display area rotation
+ * Copyright (c) 2026
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#ifndef _ROTATE_H_
+#define _ROTATE_H_
+
+#include <utils/types.h>
+
+void rotate_area(u32 *fb, u32 stride, s32 x1, s32 y1, s32 x2, s32 y2,
+                 const u32 *src);
+
+#endif
@@ -7,18 +7,40 @@
  * version 2, as published by the Free Software Foundation.
  */
 
+#include <libs/fatfs/ff.h>
 #include <mem/heap.h>
+#include <mem/pool.h>
+#include <memory_map.h>
 #include <soc/timer.h>
+#include <storage/emmc.h>
+#include <storage/mbr_gpt.h>
+#include <storage/mmc_def.h>
+#include <storage/nx_emmc_bis.h>
 #include <storage/sd.h>
 #include <storage/sdmmc.h>
 #include <string.h>
+#include <utils/ini.h>
+#include <utils/sprintf.h>
+#include <utils/util.h>
 
 #include "config.h"
 #include "sd_tester.h"
+#include "worker.h"
 
 // External SD storage from BDK
 extern sdmmc_storage_t sd_storage;
 
+// Device the read tests run on
+static test_dev_t dev_sel = TEST_DEV_SD;
+static sdmmc_storage_t *dev_storage = &sd_storage;
+static u32 dev_sectors;
+
+static const char *device_strings[TEST_DEV_MAX] = {"SD", "eMMC GPP",
+                                                   "eMMC BOOT0", "eMMC BOOT1"};
+
+static const char *emmc_mode_strings[] = {"Init Failed", "1-bit HS52",
+                                          "8-bit HS52", "HS200", "HS400"};
+
 // Speed mode strings
 static const char *speed_mode_strings[] = {"Init Failed", "1-bit HS25",
                                            "4-bit HS25",  "UHS SDR82",
@@ -35,11 +57,230 @@ const char *sd_tester_get_speed_mode_string(u32 mode) {
   return speed_mode_strings[mode];
 }
 
+// Read the SD extension registers if they were not parsed yet
+static void probe_ext_regs(void) {
+  if (sd_storage.ser.valid)
+    return;
+
+  u8 *buf = (u8 *)malloc(512);
+  if (!buf)
+    return;
+
+  u32 start_us = get_tmr_us();
+  sd_storage_get_ext_regs(&sd_storage, buf);
+  sd_storage.init_prof.time_us[SD_INIT_STEP_EXT_REGS] = get_tmr_us() - start_us;
+  free(buf);
+}
+
+static const char *init_step_strings[SD_INIT_STEP_MAX] = {
+    "Power up", "IF cond",  "ACMD41",    "CID",    "RCA", "CSD",
+    "Select",   "SCR/Bus",  "Bus speed", "Tuning", "SSR", "Ext regs"};
+
+const char *sd_tester_get_init_step_string(u32 step) {
+  if (step >= SD_INIT_STEP_MAX)
+    return "";
+  return init_step_strings[step];
+}
+
+sd_init_prof_t *sd_tester_get_init_prof(void) {
+  return &sd_storage.init_prof;
+}
+
+const char *sd_tester_get_device_string(u32 dev) {
+  if (dev >= TEST_DEV_MAX)
+    dev = TEST_DEV_SD;
+  return device_strings[dev];
+}
+
+test_dev_t sd_tester_get_device(void) { return dev_sel; }
+
+u32 sd_tester_get_device_sectors(void) {
+  return dev_sel == TEST_DEV_SD ? sd_storage.sec_cnt : dev_sectors;
+}
+
+// Selects the read test target. eMMC is initialized on first use and the
+// requested hardware partition is switched in.
+int sd_tester_set_device(test_dev_t dev) {
+  static const u32 emmc_parts[TEST_DEV_MAX] = {0, EMMC_GPP, EMMC_BOOT0,
+                                               EMMC_BOOT1};
+
+  if (dev >= TEST_DEV_MAX)
+    return 0;
+
+  if (dev == TEST_DEV_SD) {
+    dev_sel = dev;
+    dev_storage = &sd_storage;
+    return 1;
+  }
+
+  if (!emmc_storage.initialized && !emmc_initialize(false))
+    return 0;
+
+  if (!emmc_set_partition(emmc_parts[dev]))
+    return 0;
+
+  dev_sel = dev;
+  dev_storage = &emmc_storage;
+  if (dev == TEST_DEV_EMMC_GPP)
+    dev_sectors = emmc_storage.sec_cnt;
+  else
+    dev_sectors = emmc_storage.ext_csd.boot_mult * (SZ_128K / 512);
+
+  return 1;
+}
+
+int sd_tester_get_emmc_health(sd_emmc_health_t *health) {
+  memset(health, 0, sizeof(sd_emmc_health_t));
+
+  if (!emmc_storage.initialized && !emmc_initialize(false))
+    return 0;
+
+  memcpy(health->prod_name, emmc_storage.cid.prod_name, 6);
+  health->manfid = emmc_storage.cid.manfid;
+  health->capacity_mb = emmc_storage.sec_cnt / 2048;
+  health->boot_kb = emmc_storage.ext_csd.boot_mult * 128;
+  health->cache_kb = emmc_storage.ext_csd.cache_size;
+  health->speed_mode = emmc_mode_strings[MIN(emmc_get_mode(), 4)];
+  health->ext_csd_rev = emmc_storage.ext_csd.rev;
+  health->life_est_a = emmc_storage.ext_csd.dev_life_est_a;
+  health->life_est_b = emmc_storage.ext_csd.dev_life_est_b;
+  health->pre_eol = emmc_storage.ext_csd.pre_eol_info;
+
+  return 1;
+}
+
 void sd_tester_get_card_info(sd_card_info_t *info) {
   info->total_sectors = sd_storage.sec_cnt;
   info->capacity_mb = (u32)((u64)sd_storage.sec_cnt * 512 / (1024 * 1024));
   info->capacity_gb = info->capacity_mb / 1024;
   info->speed_mode = sd_tester_get_speed_mode_string(sd_get_mode());
+
+  probe_ext_regs();
+  info->cmdq_depth = sd_storage_get_cmdq_depth(&sd_storage);
+  info->has_cache = sd_storage.ser.valid && sd_storage.ser.cache_ext;
+  info->bus_cfg_cached = sd_storage.bus_cfg_cached;
+  info->init_ms = sd_storage.init_prof.total_us / 1000;
+}
+
+// Bus config cache file: header followed by sd_bus_cfg_t entries
+typedef struct {
+  u32 magic;
+  u32 count;
+} bus_cfg_hdr_t;
+
+// Merges the cached bus configs from the SD and saves them back if changed.
+// The file is on the card's FAT volume, so at boot it is only read after the
+// first init: that init tunes, and the saved driver type and power limit are
+// applied here. Later inits (error recovery, card swaps) restore from cache
+void sd_tester_sync_bus_cfg(void) {
+  u32 size = 0;
+  bus_cfg_hdr_t *hdr = (bus_cfg_hdr_t *)sd_file_read(BUS_CFG_FILE, &size);
+  if (hdr) {
+    if (size >= sizeof(bus_cfg_hdr_t) && hdr->magic == BUS_CFG_MAGIC &&
+        size == sizeof(bus_cfg_hdr_t) + hdr->count * sizeof(sd_bus_cfg_t))
+      sd_storage_bus_cfg_import((sd_bus_cfg_t *)(hdr + 1), hdr->count);
+    free(hdr);
+  }
+
+  sd_storage_bus_cfg_apply(&sd_storage);
+
+  if (!sd_storage_bus_cfg_dirty())
+    return;
+
+  sd_bus_cfg_t *cfgs;
+  u32 count = sd_storage_bus_cfg_export(&cfgs);
+  size = sizeof(bus_cfg_hdr_t) + count * sizeof(sd_bus_cfg_t);
+
+  hdr = (bus_cfg_hdr_t *)malloc(size);
+  if (!hdr)
+    return;
+
+  hdr->magic = BUS_CFG_MAGIC;
+  hdr->count = count;
+  memcpy(hdr + 1, cfgs, count * sizeof(sd_bus_cfg_t));
+
+  f_mkdir(SCRATCH_DIR);
+  sd_save_to_file(hdr, size, BUS_CFG_FILE);
+  free(hdr);
+}
+
+static struct {
+  u32 allocs;
+  u32 used;
+  u32 serial;
+} heap_mark;
+
+// Marks the heap state at test start, for the leak report at test end
+void sd_tester_heap_mark(void) {
+  heap_stats_t stats;
+  heap_get_stats(&stats);
+
+  heap_mark.allocs = stats.allocs;
+  heap_mark.used = stats.used;
+#ifdef BDK_MALLOC_TRACK
+  heap_mark.serial = heap_track_mark();
+#endif
+}
+
+#ifdef BDK_MALLOC_TRACK
+static heap_site_t heap_sites[HEAP_DUMP_SITES];
+#endif
+
+// Allocations still live since the mark. With allocation tracking, long-lived
+// ones tagged with heap_track_keep (CRC32 table) are not counted
+u32 sd_tester_heap_leaks(void) {
+#ifdef BDK_MALLOC_TRACK
+  u32 leaks = 0;
+  u32 cnt = heap_track_sites(heap_sites, HEAP_DUMP_SITES, heap_mark.serial);
+  for (u32 i = 0; i < cnt; i++)
+    leaks += heap_sites[i].count;
+  return leaks;
+#else
+  heap_stats_t stats;
+  heap_get_stats(&stats);
+
+  return stats.allocs > heap_mark.allocs ? stats.allocs - heap_mark.allocs : 0;
+#endif
+}
+
+// Writes heap usage and the allocations still live since the mark. Uses
+// static buffers so the dump does not show up in itself
+int sd_tester_heap_dump(void) {
+  static char buf[HEAP_DUMP_SITES * 64 + 512];
+  heap_stats_t stats;
+  heap_get_stats(&stats);
+
+  char *p = buf;
+  s_printf(p, "Heap used %d KB, peak %d KB, allocs %d\n", stats.used >> 10,
+           stats.peak >> 10, stats.allocs);
+  p += strlen(p);
+  s_printf(p, "Free %d KB, largest %d KB, fragmentation %d.%d%%\n",
+           stats.free >> 10, stats.largest_free >> 10, stats.frag / 10,
+           stats.frag % 10);
+  p += strlen(p);
+  s_printf(p, "Since test start: %d allocs, %d bytes\n",
+           (int)(stats.allocs - heap_mark.allocs),
+           (int)(stats.used - heap_mark.used));
+  p += strlen(p);
+
+#ifdef BDK_MALLOC_TRACK
+  heap_site_t *sites = heap_sites;
+  u32 cnt = heap_track_sites(sites, HEAP_DUMP_SITES, heap_mark.serial);
+
+  s_printf(p, "\nLive since test start:\ncaller      count  bytes\n");
+  p += strlen(p);
+  for (u32 i = 0; i < cnt; i++) {
+    if (sites[i].tag)
+      s_printf(p, "0x%08X %6d %d\n", sites[i].tag, sites[i].count,
+               sites[i].bytes);
+    else
+      s_printf(p, "other      %6d %d\n", sites[i].count, sites[i].bytes);
+    p += strlen(p);
+  }
+#endif
+
+  f_mkdir(SCRATCH_DIR);
+  return sd_save_to_file(buf, strlen(buf), HEAP_DUMP_FILE) ? -1 : 0;
 }
 
 u32 sd_tester_get_avg_latency(sd_test_result_t *result) {
@@ -52,6 +293,54 @@ int sd_tester_is_passed(sd_test_result_t *result) {
   return (result->read_errors == 0);
 }
 
+u32 sd_tester_get_iops(sd_qd_result_t *result) {
+  if (result->elapsed_us == 0)
+    return 0;
+  return (u32)((u64)result->io.blocks_passed * 1000000 / result->elapsed_us);
+}
+
+u32 sd_tester_get_kbps(u32 sectors, u32 elapsed_us) {
+  if (elapsed_us == 0)
+    return 0;
+  return (u32)((u64)sectors * 1000000 / 2 / elapsed_us);
+}
+
+// Simple xorshift32 PRNG for random LBA selection
+static u32 rng_state = 0x2545F491;
+
+// Read buffers come from a pool in the SDXC DMA window, so the tests do not
+// churn the heap and every buffer is cache line aligned
+static pool_t io_pool;
+
+static u8 *io_buf_alloc(void) {
+  if (!io_pool.obj_size)
+    pool_init(&io_pool, (void *)SDXC_BUF_ALIGNED, SDMMC_DMA_BUF_SZ,
+              BLOCKS_PER_READ * 512);
+
+  return (u8 *)pool_alloc(&io_pool);
+}
+
+static void io_buf_free(u8 *buf) { pool_free(&io_pool, buf); }
+
+static void rng_seed(u32 seed) {
+  rng_state = seed ? seed : 0x2545F491;
+}
+
+static u32 rng_next(void) {
+  u32 x = rng_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  rng_state = x;
+  return x;
+}
+
+// Random aligned sector for an I/O of RANDOM_IO_SECTORS
+static u32 random_io_sector(void) {
+  u32 slots = sd_tester_get_device_sectors() / RANDOM_IO_SECTORS;
+  return (rng_next() % slots) * RANDOM_IO_SECTORS;
+}
+
 // Record a single latency measurement
 static void record_latency(sd_test_result_t *result, u32 latency_us,
                            int read_ok) {
@@ -74,100 +363,1492 @@ static void record_latency(sd_test_result_t *result, u32 latency_us,
     result->slow_blocks++;
 }
 
+// Same for writes, failures are counted as write errors
+static void record_write_latency(sd_test_result_t *result, u32 latency_us,
+                                 int write_ok) {
+  if (!write_ok) {
+    result->blocks_tested++;
+    result->write_errors++;
+    return;
+  }
+
+  record_latency(result, latency_us, 1);
+}
+
+void sd_tester_trend_init(sd_trend_t *trend) {
+  memset(trend, 0, sizeof(sd_trend_t));
+  trend->span = 1;
+
+  u32 sectors = sd_tester_get_device_sectors();
+  trend->slice_sectors = sectors / TREND_LBA_POINTS + 1;
+  trend->cell_sectors = sectors / SURFACE_CELLS + 1;
+}
+
+// Log scale bin with 4 steps per octave, values below 4 get their own bin
+static u32 trend_lat_bin(u32 us) {
+  if (us < 4)
+    return us;
+
+  u32 msb = 31 - __builtin_clz(us);
+  u32 bin = msb * 4 + ((us >> (msb - 2)) & 3) - 4;
+
+  return MIN(bin, TREND_LAT_BINS - 1);
+}
+
+// Upper bound of a bin
+static u32 trend_lat_bin_us(u32 bin) {
+  if (bin < 4)
+    return bin;
+
+  u32 shift = (bin + 4) / 4 - 2;
+  return ((4 + (bin & 3)) << shift) + (1 << shift) - 1;
+}
+
+static void trend_merge(sd_trend_point_t *dst, const sd_trend_point_t *src) {
+  dst->kbps_min = MIN(dst->kbps_min, src->kbps_min);
+  dst->kbps_max = MAX(dst->kbps_max, src->kbps_max);
+  dst->p99_us = MAX(dst->p99_us, src->p99_us);
+  dst->max_us = MAX(dst->max_us, src->max_us);
+}
+
+// Closes the current interval into the last point, halving the resolution
+// of the whole history when it is full
+static void trend_close_interval(sd_trend_t *trend) {
+  sd_trend_point_t interval;
+  interval.kbps_min = sd_tester_get_kbps(trend->sectors, trend->busy_us);
+  interval.kbps_max = interval.kbps_min;
+  interval.max_us = trend->max_us;
+  interval.p99_us = 0;
+
+  u32 rank = trend->ios - trend->ios / 100;
+  for (u32 bin = 0, seen = 0; bin < TREND_LAT_BINS; bin++) {
+    seen += trend->lat_bins[bin];
+    if (seen >= rank) {
+      interval.p99_us = trend_lat_bin_us(bin);
+      break;
+    }
+  }
+
+  if (!trend->count || trend->fill == trend->span) {
+    if (trend->count == TREND_POINTS) {
+      for (u32 i = 0; i < TREND_POINTS / 2; i++) {
+        trend->points[i] = trend->points[i * 2];
+        trend_merge(&trend->points[i], &trend->points[i * 2 + 1]);
+      }
+      trend->count = TREND_POINTS / 2;
+      trend->span *= 2;
+    }
+
+    trend->points[trend->count++] = interval;
+    trend->fill = 1;
+  } else {
+    trend_merge(&trend->points[trend->count - 1], &interval);
+    trend->fill++;
+  }
+
+  trend->busy_us = 0;
+  trend->sectors = 0;
+  trend->ios = 0;
+  trend->max_us = 0;
+  memset(trend->lat_bins, 0, sizeof(trend->lat_bins));
+  trend->serial++;
+}
+
+// Marks every cell the read touched, a read can straddle a cell boundary
+static void trend_surface(sd_trend_t *trend, u32 sector, u32 sectors,
+                          u32 latency_us, int read_ok) {
+  u32 first = sector / trend->cell_sectors;
+  u32 last = (sector + sectors - 1) / trend->cell_sectors;
+  if (first >= SURFACE_CELLS)
+    return;
+  last = MIN(last, SURFACE_CELLS - 1);
+
+  u8 cls;
+  if (!read_ok)
+    cls = SURFACE_ERROR;
+  else if (latency_us < SURFACE_FAST_US)
+    cls = SURFACE_FAST;
+  else if (latency_us < SURFACE_OK_US)
+    cls = SURFACE_OK;
+  else if (latency_us < SURFACE_SLOW_US)
+    cls = SURFACE_SLOW;
+  else
+    cls = SURFACE_STALL;
+
+  for (u32 cell = first; cell <= last; cell++) {
+    if (cls > trend->surface[cell]) {
+      trend->surface[cell] = cls;
+      trend->surface_dirty[cell / 32] |= 1u << (cell % 32);
+    }
+  }
+}
+
+static void trend_add(sd_trend_t *trend, u32 sector, u32 sectors,
+                      u32 latency_us, int read_ok) {
+  if (!trend)
+    return;
+
+  trend_surface(trend, sector, sectors, latency_us, read_ok);
+
+  u32 slice = sector / trend->slice_sectors;
+  if (slice < TREND_LBA_POINTS && latency_us > trend->lba_max_us[slice])
+    trend->lba_max_us[slice] = latency_us;
+
+  // Failed reads keep their time up to the error or timeout but move no data,
+  // so they pull the interval throughput down and show in the latency charts
+  trend->busy_us += latency_us;
+  if (read_ok)
+    trend->sectors += sectors;
+  trend->ios++;
+  trend->max_us = MAX(trend->max_us, latency_us);
+  trend->lat_bins[trend_lat_bin(latency_us)]++;
+
+  if (trend->busy_us >= TREND_INTERVAL_US)
+    trend_close_interval(trend);
+}
+
+// Prepares a sequential read job over the first sector_limit sectors
+int sd_tester_job_seq(sd_job_t *job, sd_test_result_t *result,
+                      u32 sector_limit) {
+  memset(job, 0, sizeof(sd_job_t));
+  job->buffer = io_buf_alloc();
+  if (!job->buffer)
+    return -1;
+
+  u32 total_sectors = sd_tester_get_device_sectors();
+  job->type = SD_JOB_SEQ;
+  job->result = result;
+  job->total = (sector_limit == 0 || sector_limit > total_sectors)
+                   ? total_sectors
+                   : sector_limit;
+
+  sd_tester_init_result(result);
+  return 0;
+}
+
+// Prepares a butterfly job, reading inwards from both ends of the device
+int sd_tester_job_btf(sd_job_t *job, sd_test_result_t *result,
+                      u32 iterations) {
+  memset(job, 0, sizeof(sd_job_t));
+  job->buffer = io_buf_alloc();
+  if (!job->buffer)
+    return -1;
+
+  u32 total_sectors = sd_tester_get_device_sectors();
+  job->type = SD_JOB_BTF;
+  job->result = result;
+  job->high = total_sectors - BLOCKS_PER_READ;
+
+  // Calculate iterations - full test goes until pointers meet
+  u32 max_iterations = (total_sectors / BLOCKS_PER_READ) / 2;
+  job->total = (iterations == 0 || iterations > max_iterations)
+                   ? max_iterations
+                   : iterations;
+
+  sd_tester_init_result(result);
+  return 0;
+}
+
+static void job_step_seq(sd_job_t *job) {
+  // Calculate how many sectors to read (handle end of card)
+  u32 sectors_to_read = MIN(BLOCKS_PER_READ, job->total - job->pos);
+
+  // Timed read
+  u32 start_us = get_tmr_us();
+  int read_ok =
+      sdmmc_storage_read(dev_storage, job->pos, sectors_to_read, job->buffer);
+  job->lat_low = get_tmr_us() - start_us;
+
+  record_latency(job->result, job->lat_low, read_ok);
+  trend_add(job->trend, job->pos, sectors_to_read, job->lat_low, read_ok);
+  job->pos += sectors_to_read;
+}
+
+static void job_step_btf(sd_job_t *job) {
+  // Read from low end
+  u32 start_low = get_tmr_us();
+  int read_ok_low =
+      sdmmc_storage_read(dev_storage, job->low, BLOCKS_PER_READ, job->buffer);
+  job->lat_low = get_tmr_us() - start_low;
+  record_latency(job->result, job->lat_low, read_ok_low);
+  trend_add(job->trend, job->low, BLOCKS_PER_READ, job->lat_low, read_ok_low);
+
+  // Read from high end
+  u32 start_high = get_tmr_us();
+  int read_ok_high =
+      sdmmc_storage_read(dev_storage, job->high, BLOCKS_PER_READ, job->buffer);
+  job->lat_high = get_tmr_us() - start_high;
+  record_latency(job->result, job->lat_high, read_ok_high);
+  trend_add(job->trend, job->high, BLOCKS_PER_READ, job->lat_high,
+            read_ok_high);
+
+  // Move pointers
+  job->low += BLOCKS_PER_READ;
+  job->high -= BLOCKS_PER_READ;
+  job->pos++;
+
+  // Pointers met before the iteration count
+  if (job->low >= job->high)
+    job->total = job->pos;
+}
+
+// Runs I/Os until budget_us has passed. Returns 1 once the job is complete
+int sd_tester_job_step(sd_job_t *job, u32 budget_us) {
+  u32 start_us = get_tmr_us();
+
+  while (job->pos < job->total) {
+    if (job->type == SD_JOB_SEQ)
+      job_step_seq(job);
+    else
+      job_step_btf(job);
+
+    if (get_tmr_us() - start_us >= budget_us)
+      break;
+  }
+
+  return job->pos >= job->total;
+}
+
+// Releases the job, its result holds whatever was read so far
+void sd_tester_job_end(sd_job_t *job) {
+  // Close the last, partial interval so the end of the run is charted
+  if (job->trend && job->trend->ios)
+    trend_close_interval(job->trend);
+
+  io_buf_free(job->buffer);
+  job->buffer = NULL;
+}
+
 int sd_tester_run_sequential(sd_test_result_t *result, u32 sector_limit,
                              void (*progress_cb)(u32 current, u32 total,
                                                  u32 latency, u32 errors)) {
-  u8 *buffer = (u8 *)malloc(BLOCKS_PER_READ * 512);
-  if (!buffer)
+  sd_job_t job;
+  if (sd_tester_job_seq(&job, result, sector_limit))
     return -1;
 
-  u32 total_sectors = sd_storage.sec_cnt;
-  u32 test_sectors = (sector_limit == 0 || sector_limit > total_sectors)
-                         ? total_sectors
-                         : sector_limit;
+  while (!sd_tester_job_step(&job, JOB_STEP_US)) {
+    if (progress_cb)
+      progress_cb(job.pos, job.total, job.lat_low, result->read_errors);
+  }
 
-  sd_tester_init_result(result);
+  // Final progress update
+  if (progress_cb)
+    progress_cb(job.total, job.total, 0, result->read_errors);
 
-  u32 last_progress = 0;
+  sd_tester_job_end(&job);
+  return 0;
+}
+
+int sd_tester_run_butterfly(sd_test_result_t *result, u32 iterations,
+                            void (*progress_cb)(u32 current, u32 total,
+                                                u32 lat_low, u32 lat_high)) {
+  sd_job_t job;
+  if (sd_tester_job_btf(&job, result, iterations))
+    return -1;
 
-  for (u32 sector = 0; sector < test_sectors; sector += BLOCKS_PER_READ) {
-    // Calculate how many sectors to read (handle end of card)
-    u32 sectors_to_read = BLOCKS_PER_READ;
-    if (sector + sectors_to_read > test_sectors)
-      sectors_to_read = test_sectors - sector;
+  while (!sd_tester_job_step(&job, JOB_STEP_US)) {
+    if (progress_cb)
+      progress_cb(job.pos, job.total, job.lat_low, job.lat_high);
+  }
 
-    // Timed read
+  // Final progress update
+  if (progress_cb)
+    progress_cb(job.total, job.total, 0, 0);
+
+  sd_tester_job_end(&job);
+  return 0;
+}
+
+// Random reads at QD1 with the legacy synchronous read path
+static int run_random_qd1(sd_qd_result_t *result, u32 ios, u8 *buffer,
+                          void (*progress_cb)(u32 current, u32 total,
+                                              u32 latency, u32 errors)) {
+  u32 test_start = get_tmr_us();
+
+  for (u32 i = 0; i < ios; i++) {
     u32 start_us = get_tmr_us();
-    int read_ok =
-        sdmmc_storage_read(&sd_storage, sector, sectors_to_read, buffer);
+    int read_ok = sdmmc_storage_read(dev_storage, random_io_sector(),
+                                     RANDOM_IO_SECTORS, buffer);
     u32 latency_us = get_tmr_us() - start_us;
+    record_latency(&result->io, latency_us, read_ok);
 
-    // Record result
-    record_latency(result, latency_us, read_ok);
+    if (progress_cb && (i % 256 == 0))
+      progress_cb(i, ios, latency_us, result->io.read_errors);
+  }
+
+  result->elapsed_us = get_tmr_us() - test_start;
+  return 0;
+}
+
+// Random reads with up to queue_depth tasks in flight via SD command queue
+static int run_random_cmdq(sd_qd_result_t *result, u32 ios, u8 *buffer,
+                           void (*progress_cb)(u32 current, u32 total,
+                                               u32 latency, u32 errors)) {
+  sd_cmdq_t *cmdq = (sd_cmdq_t *)malloc(sizeof(sd_cmdq_t));
+  if (!cmdq)
+    return -1;
+
+  if (!sd_storage_cmdq_init(cmdq, &sd_storage, result->queue_depth)) {
+    free(cmdq);
+    return -2;
+  }
+  result->queue_depth = cmdq->depth;
 
-    // Progress callback
-    if (progress_cb && (sector - last_progress >= PROGRESS_UPDATE_SECTORS)) {
-      progress_cb(sector, test_sectors, latency_us, result->read_errors);
-      last_progress = sector;
+  u32 issued = 0;
+  u32 completed = 0;
+  u32 inflight = 0;
+  u32 last_latency = 0;
+  u32 test_start = get_tmr_us();
+  u32 last_progress_ms = get_tmr_ms();
+
+  while (completed < ios) {
+    // Keep the queue full
+    while (inflight < cmdq->depth && issued < ios) {
+      // Tasks complete out of order, so each task id owns a buffer slot.
+      // Submit takes the same lowest free id
+      int slot = sd_storage_cmdq_get_free(cmdq);
+      if (slot < 0)
+        break;
+      int tid = sd_storage_cmdq_submit(
+          cmdq, random_io_sector(), RANDOM_IO_SECTORS,
+          buffer + slot * RANDOM_IO_SECTORS * 512, 0);
+      if (tid < 0) {
+        // Submission failed, account it as an error
+        record_latency(&result->io, 0, 0);
+        issued++;
+        completed++;
+        continue;
+      }
+      issued++;
+      inflight++;
+      last_progress_ms = get_tmr_ms(); // A new task gets the full timeout
+    }
+
+    // Execute ready tasks, then collect completions. If the card stops
+    // reporting ready tasks, discard the queue so the test can finish.
+    if (sd_storage_cmdq_process(cmdq) > 0)
+      last_progress_ms = get_tmr_ms();
+    else if (get_tmr_ms() - last_progress_ms > 2000) {
+      sd_storage_cmdq_abort(cmdq);
+      last_progress_ms = get_tmr_ms();
+    }
+
+    sd_cmdq_task_t task;
+    while (sd_storage_cmdq_reap(cmdq, &task) >= 0) {
+      last_latency = task.done_us - task.submit_us;
+      record_latency(&result->io, last_latency, task.result);
+      inflight--;
+      completed++;
+
+      if (progress_cb && (completed % 256 == 0))
+        progress_cb(completed, ios, last_latency, result->io.read_errors);
     }
   }
 
+  result->elapsed_us = get_tmr_us() - test_start;
+
+  sd_storage_cmdq_end(cmdq);
+  free(cmdq);
+  return 0;
+}
+
+int sd_tester_run_random_qd(sd_qd_result_t *result, u32 ios, u32 queue_depth,
+                            void (*progress_cb)(u32 current, u32 total,
+                                                u32 latency, u32 errors)) {
+  memset(result, 0, sizeof(sd_qd_result_t));
+  sd_tester_init_result(&result->io);
+  result->queue_depth = queue_depth ? queue_depth : 1;
+
+  u32 buf_ios = result->queue_depth > 1 ? SD_CMDQ_DEPTH_MAX : 1;
+  u8 *buffer = (u8 *)malloc(buf_ios * RANDOM_IO_SECTORS * 512);
+  if (!buffer)
+    return -1;
+
+  rng_seed(get_tmr_us());
+
+  int res;
+  if (result->queue_depth == 1) {
+    res = run_random_qd1(result, ios, buffer, progress_cb);
+  } else if (dev_sel == TEST_DEV_SD) {
+    probe_ext_regs();
+    res = run_random_cmdq(result, ios, buffer, progress_cb);
+  } else {
+    res = -2; // SD command queueing only
+  }
+
   // Final progress update
   if (progress_cb)
-    progress_cb(test_sectors, test_sectors, 0, result->read_errors);
+    progress_cb(ios, ios, 0, result->io.read_errors);
 
   free(buffer);
+  return res;
+}
+
+static u32 au_sectors(void) {
+  u32 au = sd_storage_get_ssr_au(&sd_storage) * 2;
+  return au ? au : DEFAULT_AU_SECTORS;
+}
+
+// Creates a contiguous scratch file and returns its first AU aligned sector.
+// The file is padded by one AU so the aligned range always fits inside it.
+static int scratch_create(u32 sectors, u32 *start_sector) {
+  FIL fp;
+  u32 au = au_sectors();
+
+  f_mkdir(SCRATCH_DIR);
+  if (f_open(&fp, SCRATCH_FILE, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+    return -1;
+
+  if (f_expand(&fp, (FSIZE_t)(sectors + au) * 512, 1) != FR_OK) {
+    f_close(&fp);
+    f_unlink(SCRATCH_FILE);
+    return -3;
+  }
+
+  u32 start = sd_fs.database + (fp.obj.sclust - 2) * sd_fs.csize;
+  *start_sector = ((start + au - 1) / au) * au;
+  f_close(&fp);
   return 0;
 }
 
-int sd_tester_run_butterfly(sd_test_result_t *result, u32 iterations,
-                            void (*progress_cb)(u32 current, u32 total,
-                                                u32 lat_low, u32 lat_high)) {
-  u8 *buffer = (u8 *)malloc(BLOCKS_PER_READ * 512);
+// Puts the scratch range into a known (erased) state, one AU at a time
+static int precondition(u32 start, u32 sectors) {
+  u32 au = au_sectors();
+
+  for (u32 off = 0; off < sectors; off += au) {
+    if (!sd_storage_erase(&sd_storage, start + off, MIN(au, sectors - off),
+                          SD_ERASE_ARG))
+      return 0;
+  }
+
+  return 1;
+}
+
+static void scratch_remove(void) {
+  f_unlink(SCRATCH_FILE);
+}
+
+// Sequential write pass over the scratch area
+static u32 write_pass(sd_test_result_t *result, u32 start, u32 sectors,
+                      u8 *buffer, u32 progress_base, u32 progress_total,
+                      void (*progress_cb)(u32 current, u32 total,
+                                          u32 latency, u32 errors)) {
+  u32 pass_start = get_tmr_us();
+  u32 last_progress = 0;
+
+  for (u32 off = 0; off < sectors; off += BLOCKS_PER_READ) {
+    u32 count = MIN(BLOCKS_PER_READ, sectors - off);
+
+    u32 start_us = get_tmr_us();
+    int write_ok =
+        sdmmc_storage_write(&sd_storage, start + off, count, buffer);
+    u32 latency_us = get_tmr_us() - start_us;
+    record_write_latency(result, latency_us, write_ok);
+
+    if (progress_cb && (off - last_progress >= PROGRESS_UPDATE_SECTORS)) {
+      progress_cb(progress_base + off, progress_total, latency_us,
+                  result->write_errors);
+      last_progress = off;
+    }
+  }
+
+  return get_tmr_us() - pass_start;
+}
+
+int sd_tester_run_write_cache(sd_cache_result_t *result,
+                              void (*progress_cb)(u32 current, u32 total,
+                                                  u32 latency, u32 errors)) {
+  memset(result, 0, sizeof(sd_cache_result_t));
+  sd_tester_init_result(&result->nocache);
+  sd_tester_init_result(&result->cache);
+
+  probe_ext_regs();
+  result->cache_supported = sd_storage.ser.valid && sd_storage.ser.cache_ext;
+  result->sectors = WRITE_BENCH_SECTORS;
+
+  u8 *buffer = io_buf_alloc();
   if (!buffer)
     return -1;
 
-  u32 total_sectors = sd_storage.sec_cnt;
-  u32 low = 0;
-  u32 high = total_sectors - BLOCKS_PER_READ;
+  // Incompressible-ish pattern so controllers cannot shortcut the writes
+  rng_seed(get_tmr_us());
+  for (u32 i = 0; i < BLOCKS_PER_READ * 512 / 4; i++)
+    ((u32 *)buffer)[i] = rng_next();
 
-  // Calculate iterations - full test goes until pointers meet
-  u32 max_iterations = (total_sectors / BLOCKS_PER_READ) / 2;
-  u32 test_iterations = (iterations == 0 || iterations > max_iterations)
-                            ? max_iterations
-                            : iterations;
+  u32 start;
+  int res = scratch_create(WRITE_BENCH_SECTORS, &start);
+  if (res) {
+    io_buf_free(buffer);
+    return res;
+  }
 
-  sd_tester_init_result(result);
+  u32 total = result->cache_supported ? WRITE_BENCH_SECTORS * 2
+                                      : WRITE_BENCH_SECTORS;
+
+  // Pass 1: card cache disabled
+  if (result->cache_supported)
+    sd_storage_cache_enable(&sd_storage, false);
+  if (!precondition(start, WRITE_BENCH_SECTORS)) {
+    res = -4;
+  } else {
+    result->nocache_us = write_pass(&result->nocache, start,
+                                    WRITE_BENCH_SECTORS, buffer, 0, total,
+                                    progress_cb);
+  }
+
+  // Pass 2: card cache enabled, then flush it
+  if (!res && result->cache_supported &&
+      sd_storage_cache_enable(&sd_storage, true)) {
+    if (!precondition(start, WRITE_BENCH_SECTORS)) {
+      res = -4;
+    } else {
+      result->cache_us =
+          write_pass(&result->cache, start, WRITE_BENCH_SECTORS, buffer,
+                     WRITE_BENCH_SECTORS, total, progress_cb);
+
+      u32 flush_start = get_tmr_us();
+      if (!sd_storage_cache_flush(&sd_storage))
+        result->cache.write_errors++;
+      result->flush_us = get_tmr_us() - flush_start;
+    }
+
+    sd_storage_cache_enable(&sd_storage, false);
+  }
+
+  if (progress_cb)
+    progress_cb(total, total, 0,
+                result->nocache.write_errors + result->cache.write_errors);
+
+  scratch_remove();
+  io_buf_free(buffer);
+  return res;
+}
+
+// Erases or discards the scratch range one AU per command
+static u32 erase_pass(sd_test_result_t *result, u32 start, u32 sectors,
+                      u32 au, u32 arg, u32 progress_base, u32 progress_total,
+                      void (*progress_cb)(u32 current, u32 total,
+                                          u32 latency, u32 errors)) {
+  u32 pass_start = get_tmr_us();
+
+  for (u32 off = 0; off < sectors; off += au) {
+    u32 start_us = get_tmr_us();
+    int erase_ok = sd_storage_erase(&sd_storage, start + off,
+                                    MIN(au, sectors - off), arg);
+    u32 latency_us = get_tmr_us() - start_us;
+    record_write_latency(result, latency_us, erase_ok);
+
+    if (progress_cb)
+      progress_cb(progress_base + off, progress_total, latency_us,
+                  result->write_errors);
+  }
+
+  return get_tmr_us() - pass_start;
+}
+
+int sd_tester_run_erase(sd_erase_result_t *result,
+                        void (*progress_cb)(u32 current, u32 total,
+                                            u32 latency, u32 errors)) {
+  memset(result, 0, sizeof(sd_erase_result_t));
+  sd_tester_init_result(&result->erase);
+  sd_tester_init_result(&result->discard);
+
+  if (!(sd_storage.csd.cmdclass & CCC_ERASE))
+    return -2;
+
+  u32 au = au_sectors();
+  result->au_sectors = au;
+  result->sectors = ((ERASE_BENCH_SECTORS + au - 1) / au) * au;
+  result->discard_supported = sd_storage.ssr.discard;
+
+  u8 *buffer = io_buf_alloc();
+  if (!buffer)
+    return -1;
+  memset(buffer, 0x5A, BLOCKS_PER_READ * 512);
+
+  u32 start;
+  int res = scratch_create(result->sectors, &start);
+  if (res) {
+    io_buf_free(buffer);
+    return res;
+  }
+
+  u32 total = result->discard_supported ? result->sectors * 2
+                                        : result->sectors;
+
+  // Erase over previously allocated file data
+  result->erase_us = erase_pass(&result->erase, start, result->sectors, au,
+                                SD_ERASE_ARG, 0, total, progress_cb);
+
+  // Dirty the range again so discard has mapped data to drop
+  if (result->discard_supported) {
+    sd_test_result_t fill;
+    sd_tester_init_result(&fill);
+    write_pass(&fill, start, result->sectors, buffer, 0, 0, NULL);
+
+    result->discard_us =
+        erase_pass(&result->discard, start, result->sectors, au,
+                   SD_DISCARD_ARG, result->sectors, total, progress_cb);
+  }
 
-  for (u32 i = 0; i < test_iterations && low < high; i++) {
-    // Read from low end
-    u32 start_low = get_tmr_us();
-    int read_ok_low =
-        sdmmc_storage_read(&sd_storage, low, BLOCKS_PER_READ, buffer);
-    u32 latency_low = get_tmr_us() - start_low;
-    record_latency(result, latency_low, read_ok_low);
+  if (progress_cb)
+    progress_cb(total, total, 0,
+                result->erase.write_errors + result->discard.write_errors);
+
+  scratch_remove();
+  io_buf_free(buffer);
+  return 0;
+}
 
-    // Read from high end
-    u32 start_high = get_tmr_us();
-    int read_ok_high =
-        sdmmc_storage_read(&sd_storage, high, BLOCKS_PER_READ, buffer);
-    u32 latency_high = get_tmr_us() - start_high;
-    record_latency(result, latency_high, read_ok_high);
+#ifdef BDK_SDMMC_TRACE
+// Splits every complete command with a data phase into its driver phases
+static void analyze_trace(sd_trace_phase_t *phase, sdmmc_trace_rec_t *trace,
+                          u32 count) {
+  u64 issue = 0, response = 0, data = 0, busy = 0, total = 0;
+  u32 t_start = 0, t_issue = 0, t_rsp = 0, t_data = 0, t_busy = 0;
+  u32 first = count > TRACE_ENTRIES ? count - TRACE_ENTRIES : 0;
 
-    // Move pointers
-    low += BLOCKS_PER_READ;
-    high -= BLOCKS_PER_READ;
+  memset(phase, 0, sizeof(sd_trace_phase_t));
+  phase->dropped = first;
 
-    // Progress callback every 10 iterations
-    if (progress_cb && (i % 10 == 0)) {
-      progress_cb(i, test_iterations, latency_low, latency_high);
+  for (u32 i = first; i < count; i++) {
+    sdmmc_trace_rec_t *rec = &trace[i & (TRACE_ENTRIES - 1)];
+
+    switch (rec->event) {
+    case SDMMC_TRACE_CMD_START:
+      t_start = rec->time_us;
+      t_issue = t_rsp = t_data = t_busy = 0;
+      break;
+    case SDMMC_TRACE_CMD_ISSUE:
+      if (!t_issue)
+        t_issue = rec->time_us;
+      break;
+    case SDMMC_TRACE_RSP_DONE:
+      if (!t_rsp)
+        t_rsp = rec->time_us;
+      break;
+    case SDMMC_TRACE_DATA_DONE:
+      t_data = rec->time_us;
+      break;
+    case SDMMC_TRACE_BUSY_DONE:
+      if (t_data)
+        t_busy = rec->time_us;
+      break;
+    case SDMMC_TRACE_CMD_END:
+      if (!t_start || !t_issue || !t_rsp || !t_data || !rec->arg)
+        break;
+      if (!t_busy)
+        t_busy = t_data;
+
+      issue += t_issue - t_start;
+      response += t_rsp - t_issue;
+      data += t_data - t_rsp;
+      busy += t_busy - t_data;
+      total += rec->time_us - t_start;
+      phase->max_total_us = MAX(phase->max_total_us, rec->time_us - t_start);
+      phase->ios++;
+      t_start = 0;
+      break;
     }
   }
 
-  // Final progress update
+  if (!phase->ios)
+    return;
+
+  phase->issue_us = issue / phase->ios;
+  phase->response_us = response / phase->ios;
+  phase->data_us = data / phase->ios;
+  phase->busy_us = busy / phase->ios;
+  phase->total_us = total / phase->ios;
+}
+#endif
+
+#ifdef BDK_SDMMC_TRACE
+// TRACE_IOS sequential 64 KB reads from base or random 4 KB reads. Returns
+// the wall time, used to compare traced and untraced runs
+static u32 trace_workload(u8 *buffer, bool random, u32 base, u32 *errors) {
+  u32 start_us = get_tmr_us();
+
+  for (u32 i = 0; i < TRACE_IOS; i++) {
+    int read_ok = random ? sdmmc_storage_read(&sd_storage, random_io_sector(),
+                                              RANDOM_IO_SECTORS, buffer)
+                         : sdmmc_storage_read(&sd_storage,
+                                              base + i * BLOCKS_PER_READ,
+                                              BLOCKS_PER_READ, buffer);
+    if (!read_ok)
+      (*errors)++;
+  }
+
+  return get_tmr_us() - start_us;
+}
+#endif
+
+int sd_tester_run_trace(sd_trace_result_t *result,
+                        void (*progress_cb)(u32 current, u32 total,
+                                            u32 latency, u32 errors)) {
+  memset(result, 0, sizeof(sd_trace_result_t));
+
+#ifdef BDK_SDMMC_TRACE
+  sdmmc_trace_rec_t *trace = (sdmmc_trace_rec_t *)malloc(
+      TRACE_ENTRIES * sizeof(sdmmc_trace_rec_t));
+  u8 *buffer = io_buf_alloc();
+  if (!trace || !buffer) {
+    free(trace);
+    io_buf_free(buffer);
+    return -1;
+  }
+
+  u32 errors = 0;
+  rng_seed(get_tmr_us());
+
+  // Sequential 64 KB reads from the start of the card. The untraced run
+  // reads the next range, so the card cache favours neither
+  result->seq.untraced_us =
+      trace_workload(buffer, false, TRACE_IOS * BLOCKS_PER_READ, &errors);
+  sdmmc_trace_start(trace, TRACE_ENTRIES);
+  result->seq.traced_us = trace_workload(buffer, false, 0, &errors);
+  analyze_trace(&result->seq, trace, sdmmc_trace_stop());
+
   if (progress_cb)
-    progress_cb(test_iterations, test_iterations, 0, 0);
+    progress_cb(1, 2, 0, errors);
 
-  free(buffer);
+  // Random 4 KB reads over the whole card
+  result->rnd.untraced_us = trace_workload(buffer, true, 0, &errors);
+  sdmmc_trace_start(trace, TRACE_ENTRIES);
+  result->rnd.traced_us = trace_workload(buffer, true, 0, &errors);
+  analyze_trace(&result->rnd, trace, sdmmc_trace_stop());
+
+  if (progress_cb)
+    progress_cb(2, 2, 0, errors);
+
+  free(trace);
+  io_buf_free(buffer);
+  return 0;
+#else
+  return -2;
+#endif
+}
+
+// Widest run of taps where every read passed
+static void find_tap_window(sd_tap_scan_result_t *result) {
+  u32 start = 0, size = 0;
+
+  for (u32 tap = 0; tap <= TAP_SCAN_TAPS; tap++) {
+    if (tap < TAP_SCAN_TAPS && !result->taps[tap].errors) {
+      if (!size)
+        start = tap;
+      size++;
+      continue;
+    }
+
+    if (size > result->win_size) {
+      result->win_start = start;
+      result->win_size = size;
+    }
+    size = 0;
+  }
+}
+
+int sd_tester_run_tap_scan(sd_tap_scan_result_t *result,
+                           void (*progress_cb)(u32 current, u32 total,
+                                               u32 latency, u32 errors)) {
+  memset(result, 0, sizeof(sd_tap_scan_result_t));
+
+  // Only tuned UHS modes sample with a tap
+  result->mode = sd_get_mode();
+  if (result->mode < SD_UHS_SDR82)
+    return -2;
+
+  u8 *buffer = io_buf_alloc();
+  if (!buffer)
+    return -1;
+
+  sdmmc_t *sdmmc = sd_storage.sdmmc;
+  result->tuned_tap = sdmmc_get_tap(sdmmc);
+  rng_seed(get_tmr_us());
+
+  u32 total_errors = 0;
+  for (u32 tap = 0; tap < TAP_SCAN_TAPS; tap++) {
+    sd_tap_result_t *res = &result->taps[tap];
+    u32 read_us = 0;
+
+    sdmmc_set_tap(sdmmc, tap);
+
+    for (u32 i = 0; i < TAP_SCAN_READS && res->errors < TAP_SCAN_MAX_ERRORS;
+         i++) {
+      u32 sector = (rng_next() % (sd_storage.sec_cnt / BLOCKS_PER_READ)) *
+                   BLOCKS_PER_READ;
+
+      // Stop/status recovery clears error_sts, the latched copy keeps the
+      // status of the failed transfer
+      sdmmc->last_error_sts = 0;
+      u32 start_us = get_tmr_us();
+      int read_ok = sdmmc_storage_read_once(&sd_storage, sector,
+                                            BLOCKS_PER_READ, buffer);
+      u32 latency_us = get_tmr_us() - start_us;
+
+      res->reads++;
+      if (read_ok) {
+        read_us += latency_us;
+        continue;
+      }
+
+      res->errors++;
+      if (sdmmc->last_error_sts &
+          (SDHCI_ERR_INT_DATA_CRC | SDHCI_ERR_INT_CMD_CRC))
+        res->crc_errors++;
+    }
+
+    if (res->reads > res->errors)
+      res->kbps = sd_tester_get_kbps((res->reads - res->errors) *
+                                         BLOCKS_PER_READ, read_us);
+    total_errors += res->errors;
+
+    if (progress_cb)
+      progress_cb(tap + 1, TAP_SCAN_TAPS, 0, total_errors);
+  }
+
+  // Restore tuned tap and make sure the card is still reachable
+  sdmmc_set_tap(sdmmc, result->tuned_tap);
+  sdmmc_storage_read(&sd_storage, 0, BLOCKS_PER_READ, buffer);
+
+  find_tap_window(result);
+
+  io_buf_free(buffer);
+  return 0;
+}
+
+// Short sequential read burst at a random offset, stops at the first error
+static void drive_point_bench(sd_drive_point_t *point, u8 *buffer) {
+  u32 span = sd_storage.sec_cnt / BLOCKS_PER_READ - DRIVE_SWEEP_READS;
+  u32 sector = (rng_next() % span) * BLOCKS_PER_READ;
+  u32 read_us = 0;
+  u32 reads = 0;
+
+  for (u32 i = 0; i < DRIVE_SWEEP_READS; i++) {
+    u32 start_us = get_tmr_us();
+    if (!sdmmc_storage_read_once(&sd_storage, sector + i * BLOCKS_PER_READ,
+                                 BLOCKS_PER_READ, buffer)) {
+      point->errors++;
+      return;
+    }
+    read_us += get_tmr_us() - start_us;
+    reads++;
+  }
+
+  point->kbps = sd_tester_get_kbps(reads * BLOCKS_PER_READ, read_us);
+}
+
+int sd_tester_apply_drive(u32 drv_type, u32 pwr_limit, int persist) {
+  if (!sd_storage_set_bus_drive(&sd_storage, drv_type, pwr_limit))
+    return 0;
+
+  if (persist && sd_storage_bus_cfg_store(&sd_storage))
+    sd_tester_sync_bus_cfg();
+
+  return 1;
+}
+
+int sd_tester_run_drive_sweep(sd_drive_sweep_result_t *result,
+                              void (*progress_cb)(u32 current, u32 total,
+                                                  u32 latency, u32 errors)) {
+  sd_func_modes_t fmodes;
+
+  memset(result, 0, sizeof(sd_drive_sweep_result_t));
+
+  // Driver type and power limit only apply to the cacheable tuned UHS modes
+  if (!sd_storage_bus_drive_supported(&sd_storage) ||
+      !sd_storage_get_fmodes(&sd_storage, NULL, &fmodes))
+    return -2;
+
+  result->orig_drv_type = fmodes.cur_driver_type;
+  result->orig_pwr_limit = fmodes.cur_power_limit;
+
+  u8 *buffer = io_buf_alloc();
+  if (!buffer)
+    return -1;
+
+  rng_seed(get_tmr_us());
+
+  u32 errors = 0;
+  for (u32 drv = 0; drv < 4; drv++) {
+    for (u32 pwr = 0; pwr < DRIVE_SWEEP_PWR_LIMITS; pwr++) {
+      sd_drive_point_t *point = &result->points[drv][pwr];
+
+      point->supported = (fmodes.driver_strength & BIT(drv)) &&
+                         (fmodes.power_limit & BIT(pwr));
+      if (point->supported &&
+          sd_storage_set_bus_drive(&sd_storage, drv, pwr)) {
+        point->applied = 1;
+        drive_point_bench(point, buffer);
+        errors += point->errors;
+
+        // Prefer lower power and the default driver unless clearly faster
+        if (!point->errors &&
+            point->kbps > result->best_kbps + result->best_kbps / 50) {
+          result->found = 1;
+          result->best_drv_type = drv;
+          result->best_pwr_limit = pwr;
+          result->best_kbps = point->kbps;
+        }
+      }
+
+      if (progress_cb)
+        progress_cb(drv * DRIVE_SWEEP_PWR_LIMITS + pwr + 1,
+                    4 * DRIVE_SWEEP_PWR_LIMITS, 0, errors);
+    }
+  }
+
+  // Go back to what init selected
+  if (!sd_storage_set_bus_drive(&sd_storage, result->orig_drv_type,
+                                result->orig_pwr_limit))
+    sdmmc_storage_read(&sd_storage, 0, BLOCKS_PER_READ, buffer);
+
+  io_buf_free(buffer);
+  return 0;
+}
+
+// Per device read queue for the concurrent test. Each SDMMC controller can
+// only run one data command, so the queue is drained one read at a time.
+typedef struct {
+  sdmmc_storage_t *storage;
+  sd_dual_dev_result_t *res;
+  u8 *buffer;
+  u32 sector;   // Next sector to read
+  u32 queued;   // Reads left to issue
+  u32 issue_us; // Start of the read in flight
+  int busy;
+  int drained;
+} dual_queue_t;
+
+static void dual_queue_init(dual_queue_t *q, sdmmc_storage_t *storage,
+                            sd_dual_dev_result_t *res, u8 *buffer,
+                            u32 sector, u32 reads) {
+  q->storage = storage;
+  q->res = res;
+  q->buffer = buffer;
+  q->sector = sector;
+  q->queued = reads;
+  q->busy = 0;
+  q->drained = 0;
+  sd_tester_init_result(&res->io);
+}
+
+// Polls the read in flight and issues the next one. Returns 1 when idle.
+static int dual_queue_step(dual_queue_t *q) {
+  if (q->busy) {
+    int res = sdmmc_storage_async_poll(q->storage, NULL);
+    if (res == SDMMC_ASYNC_BUSY)
+      return 0;
+
+    record_latency(&q->res->io, get_tmr_us() - q->issue_us,
+                   res == SDMMC_ASYNC_DONE);
+    q->busy = 0;
+  }
+
+  if (!q->queued)
+    return 1;
+
+  q->queued--;
+  q->issue_us = get_tmr_us();
+  if (sdmmc_storage_read_async(q->storage, q->sector, BLOCKS_PER_READ,
+                               q->buffer))
+    q->busy = 1;
+  else
+    record_latency(&q->res->io, 0, 0);
+  q->sector += BLOCKS_PER_READ;
+
+  return 0;
+}
+
+// Runs all queues interleaved until every one of them is drained
+static u32 dual_pass(dual_queue_t *queues, u32 count, u32 progress_base,
+                     u32 progress_total,
+                     void (*progress_cb)(u32 current, u32 total,
+                                         u32 latency, u32 errors)) {
+  u32 pass_start = get_tmr_us();
+  u32 last_progress = 0;
+  u32 idle;
+
+  do {
+    idle = 0;
+    for (u32 i = 0; i < count; i++) {
+      if (queues[i].drained) {
+        idle++;
+      } else if (dual_queue_step(&queues[i])) {
+        queues[i].drained = 1;
+        queues[i].res->elapsed_us = get_tmr_us() - pass_start;
+      }
+    }
+
+    u32 done = 0, errors = 0;
+    for (u32 i = 0; i < count; i++) {
+      done += queues[i].res->io.blocks_tested;
+      errors += queues[i].res->io.read_errors;
+    }
+    if (progress_cb && done - last_progress >= 64) {
+      last_progress = done;
+      progress_cb(progress_base + done, progress_total, 0, errors);
+    }
+  } while (idle < count);
+
+  for (u32 i = 0; i < count; i++) {
+    sd_dual_dev_result_t *res = queues[i].res;
+    res->kbps = sd_tester_get_kbps(res->io.blocks_passed * BLOCKS_PER_READ,
+                                   res->elapsed_us);
+  }
+
+  return get_tmr_us() - pass_start;
+}
+
+int sd_tester_run_dual(sd_dual_result_t *result,
+                       void (*progress_cb)(u32 current, u32 total,
+                                           u32 latency, u32 errors)) {
+  dual_queue_t queues[2];
+
+  memset(result, 0, sizeof(sd_dual_result_t));
+  result->reads = DUAL_IO_READS;
+
+  u32 span = DUAL_IO_READS * BLOCKS_PER_READ;
+  if (sd_storage.sec_cnt < span * 2)
+    return -3;
+
+  // eMMC is only read, from the start of the user area
+  bool emmc_was_up = emmc_storage.initialized;
+  u32 emmc_part = emmc_storage.partition;
+  if (!emmc_was_up && !emmc_initialize(false))
+    return -2;
+  if (!emmc_set_partition(EMMC_GPP) || emmc_storage.sec_cnt < span) {
+    if (!emmc_was_up)
+      emmc_end();
+    return -2;
+  }
+
+  u8 *sd_buf = io_buf_alloc();
+  u8 *emmc_buf = io_buf_alloc();
+  if (!sd_buf || !emmc_buf) {
+    io_buf_free(sd_buf);
+    io_buf_free(emmc_buf);
+    if (!emmc_was_up)
+      emmc_end();
+    return -1;
+  }
+
+  rng_seed(get_tmr_us());
+  u32 sd_start = (rng_next() % (sd_storage.sec_cnt / span - 1)) * span;
+  u32 total = DUAL_IO_READS * 4;
+
+  // Each device alone
+  dual_queue_init(&queues[0], &sd_storage, &result->sd_alone, sd_buf,
+                  sd_start, DUAL_IO_READS);
+  dual_pass(queues, 1, 0, total, progress_cb);
+
+  dual_queue_init(&queues[0], &emmc_storage, &result->emmc_alone, emmc_buf,
+                  0, DUAL_IO_READS);
+  dual_pass(queues, 1, DUAL_IO_READS, total, progress_cb);
+
+  // Both interleaved. Same ranges so card side caching is comparable.
+  dual_queue_init(&queues[0], &sd_storage, &result->sd_shared, sd_buf,
+                  sd_start, DUAL_IO_READS);
+  dual_queue_init(&queues[1], &emmc_storage, &result->emmc_shared, emmc_buf,
+                  0, DUAL_IO_READS);
+  result->shared_us =
+      dual_pass(queues, 2, DUAL_IO_READS * 2, total, progress_cb);
+  result->aggregate_kbps = sd_tester_get_kbps(
+      (result->sd_shared.io.blocks_passed +
+       result->emmc_shared.io.blocks_passed) * BLOCKS_PER_READ,
+      result->shared_us);
+
+  if (progress_cb)
+    progress_cb(total, total, 0,
+                result->sd_shared.io.read_errors +
+                    result->emmc_shared.io.read_errors);
+
+  io_buf_free(sd_buf);
+  io_buf_free(emmc_buf);
+  if (!emmc_was_up)
+    emmc_end();
+  else
+    emmc_set_partition(emmc_part);
+
+  return 0;
+}
+
+// Finds the emuMMC user area on SD from emummc.ini. Raw partition emuMMC is
+// used as is. File based emuMMC only when its first part is contiguous.
+static int emummc_locate(u32 *gpp_sector, u32 *gpp_sectors,
+                         u32 *file_based) {
+  link_t ini_sections;
+  char path[128] = "";
+  u32 enabled = 0;
+  u32 sector = 0;
+
+  list_init(&ini_sections);
+  if (!ini_parse(&ini_sections, EMUMMC_INI, false))
+    return 0;
+
+  LIST_FOREACH_ENTRY(ini_sec_t, sec, &ini_sections, link) {
+    if (sec->type != INI_CHOICE || strcmp(sec->name, "emummc"))
+      continue;
+
+    LIST_FOREACH_ENTRY(ini_kv_t, kv, &sec->kvs, link) {
+      if (!strcmp(kv->key, "enabled"))
+        enabled = atoi(kv->val);
+      else if (!strcmp(kv->key, "sector"))
+        sector = strtol(kv->val, NULL, 16);
+      else if (!strcmp(kv->key, "path") && strlen(kv->val) < 100)
+        strcpy(path, kv->val);
+    }
+  }
+  ini_free(&ini_sections);
+
+  if (!enabled)
+    return 0;
+
+  // Raw partition: BOOT0 and BOOT1 (4 MB each) precede the user area
+  if (sector) {
+    *gpp_sector = sector + 0x4000;
+    *gpp_sectors = 0xFFFFFFFF;
+    *file_based = 0;
+    return 1;
+  }
+
+  FIL fp;
+  strcat(path, "/eMMC/00");
+  if (f_open(&fp, path, FA_READ) != FR_OK)
+    return 0;
+
+  int contiguous = fp.obj.fs->fs_type == FS_EXFAT && (fp.obj.stat & 2);
+  *gpp_sector = sd_fs.database + (fp.obj.sclust - 2) * sd_fs.csize;
+  *gpp_sectors = fp.obj.objsize / 512;
+  *file_based = 1;
+  f_close(&fp);
+
+  return contiguous;
+}
+
+// Looks up SYSTEM in the emuMMC GPT. GPT and partition table are not encrypted.
+static int emummc_find_system(u32 gpp_sector, emmc_part_t *part) {
+  gpt_t *gpt = (gpt_t *)malloc(sizeof(gpt_t));
+  if (!gpt)
+    return 0;
+
+  int found = 0;
+  if (sdmmc_storage_read(&sd_storage, gpp_sector + 1, sizeof(gpt_t) / 512,
+                         gpt) &&
+      !memcmp(&gpt->header.signature, "EFI PART", 8)) {
+    for (u32 i = 0; i < MIN(gpt->header.num_part_ents, 128); i++) {
+      const u16 *name = gpt->entries[i].name;
+      u32 j = 0;
+      while (j < 36 && name[j] && name[j] < 0x80) {
+        part->name[j] = name[j];
+        j++;
+      }
+      part->name[j] = 0;
+
+      if (!strcmp(part->name, "SYSTEM")) {
+        part->index = i;
+        part->lba_start = gpt->entries[i].lba_start;
+        part->lba_end = gpt->entries[i].lba_end;
+        part->attrs = gpt->entries[i].attrs;
+        found = 1;
+        break;
+      }
+    }
+  }
+
+  free(gpt);
+  return found;
+}
+
+// Timed pass over the SYSTEM range on one read path
+static void bis_pass(sd_bis_pass_t *pass, u32 path, u32 pattern,
+                     emmc_part_t *part, u32 gpp_sector, u32 sectors,
+                     u8 *buffer, u32 progress_base, u32 progress_total,
+                     void (*progress_cb)(u32 current, u32 total,
+                                         u32 latency, u32 errors)) {
+  u32 ios = pattern == BIS_PAT_SEQ ? sectors / BLOCKS_PER_READ
+                                   : BIS_RANDOM_IOS;
+  u32 io_sectors = pattern == BIS_PAT_SEQ ? BLOCKS_PER_READ
+                                          : RANDOM_IO_SECTORS;
+  u32 slots = sectors / RANDOM_IO_SECTORS;
+
+  if (path != BIS_PATH_RAW)
+    nx_emmc_bis_init(part, path == BIS_PATH_CACHED, gpp_sector);
+
+  u32 read_us = 0;
+  for (u32 i = 0; i < ios; i++) {
+    u32 sector = pattern == BIS_PAT_SEQ
+                     ? i * BLOCKS_PER_READ
+                     : (rng_next() % slots) * RANDOM_IO_SECTORS;
+
+    u32 start_us = get_tmr_us();
+    int read_ok;
+    if (path == BIS_PATH_RAW)
+      read_ok = sdmmc_storage_read(&sd_storage,
+                                   gpp_sector + part->lba_start + sector,
+                                   io_sectors, buffer);
+    else
+      read_ok = nx_emmc_bis_read(sector, io_sectors, buffer);
+    read_us += get_tmr_us() - start_us;
+
+    if (!read_ok)
+      pass->errors++;
+
+    if (progress_cb && (i % 64 == 0))
+      progress_cb(progress_base + i * BIS_RANDOM_IOS / ios, progress_total, 0,
+                  pass->errors);
+  }
+
+  pass->kbps = sd_tester_get_kbps((ios - pass->errors) * io_sectors, read_us);
+
+  if (path != BIS_PATH_RAW) {
+    nx_emmc_bis_stats_t stats;
+    nx_emmc_bis_get_stats(&stats);
+    nx_emmc_bis_end();
+
+    if (path == BIS_PATH_CACHED) {
+      pass->hits = stats.hits;
+      pass->misses = stats.misses;
+      pass->evictions = stats.evictions;
+    }
+  }
+}
+
+// Skewed reads through a cache smaller than the working set: a hot set
+// that should stay cached, mixed with cold reads that force evictions.
+// Returns the hot set size in clusters, 0 if the span holds no cluster
+static u32 bis_replay(sd_bis_pass_t *pass, emmc_part_t *part, u32 gpp_sector,
+                      u32 span_sectors, u8 *buffer, u32 progress_base,
+                      u32 progress_total,
+                      void (*progress_cb)(u32 current, u32 total,
+                                          u32 latency, u32 errors)) {
+  u32 span_clusters = span_sectors / 32;
+  u32 hot_clusters = MIN(BIS_REPLAY_HOT, span_clusters);
+
+  if (!span_clusters)
+    return 0;
+
+  nx_emmc_bis_set_cache_limit(BIS_REPLAY_CACHE);
+  nx_emmc_bis_init(part, true, gpp_sector);
+
+  u32 read_us = 0;
+  for (u32 i = 0; i < BIS_REPLAY_IOS; i++) {
+    u32 r = rng_next();
+    u32 cluster = (r & 0xFF) < 205 ? (r >> 8) % hot_clusters
+                                   : (r >> 8) % span_clusters;
+    u32 sector = cluster * 32 + (rng_next() % 4) * RANDOM_IO_SECTORS;
+
+    u32 start_us = get_tmr_us();
+    if (!nx_emmc_bis_read(sector, RANDOM_IO_SECTORS, buffer))
+      pass->errors++;
+    read_us += get_tmr_us() - start_us;
+
+    if (progress_cb && (i % 64 == 0))
+      progress_cb(progress_base + i, progress_total, 0, pass->errors);
+  }
+
+  pass->kbps = sd_tester_get_kbps(
+      (BIS_REPLAY_IOS - pass->errors) * RANDOM_IO_SECTORS, read_us);
+
+  nx_emmc_bis_stats_t stats;
+  nx_emmc_bis_get_stats(&stats);
+  nx_emmc_bis_end();
+  nx_emmc_bis_set_cache_limit(0xFFFFFFFF);
+
+  pass->hits = stats.hits;
+  pass->misses = stats.misses;
+  pass->evictions = stats.evictions;
+
+  return hot_clusters;
+}
+
+int sd_tester_run_bis(sd_bis_result_t *result,
+                      void (*progress_cb)(u32 current, u32 total,
+                                          u32 latency, u32 errors)) {
+  emmc_part_t part;
+  u32 gpp_sectors;
+
+  memset(result, 0, sizeof(sd_bis_result_t));
+  memset(&part, 0, sizeof(emmc_part_t));
+
+  if (!emummc_locate(&result->gpp_sector, &gpp_sectors,
+                     &result->file_based) ||
+      !emummc_find_system(result->gpp_sector, &part))
+    return -2;
+
+  u32 part_sectors = part.lba_end - part.lba_start + 1;
+  result->sectors = MIN(BIS_BENCH_SECTORS, part_sectors);
+  result->sectors -= result->sectors % BLOCKS_PER_READ;
+
+  // File based emuMMC: stay inside the first part
+  if ((u64)part.lba_start + result->sectors > gpp_sectors)
+    return -2;
+
+  u8 *buffer = io_buf_alloc();
+  if (!buffer)
+    return -1;
+
+  rng_seed(get_tmr_us());
+
+  // Reads never write back, so dirty clusters are never created
+  u32 total = BIS_PATH_MAX * BIS_PAT_MAX * BIS_RANDOM_IOS + BIS_REPLAY_IOS;
+  for (u32 path = 0; path < BIS_PATH_MAX; path++) {
+    for (u32 pat = 0; pat < BIS_PAT_MAX; pat++) {
+      bis_pass(&result->pass[path][pat], path, pat, &part,
+               result->gpp_sector, result->sectors, buffer,
+               (path * BIS_PAT_MAX + pat) * BIS_RANDOM_IOS, total,
+               progress_cb);
+    }
+  }
+
+  // Cold reads cover as much of SYSTEM as is addressable
+  u32 span = MIN(part_sectors, gpp_sectors - part.lba_start);
+  span -= span % 32;
+  result->replay_mb = span / 2048;
+  u32 hot = bis_replay(&result->replay, &part, result->gpp_sector, span,
+                       buffer, BIS_PATH_MAX * BIS_PAT_MAX * BIS_RANDOM_IOS,
+                       total, progress_cb);
+  result->replay_hot_mb = hot * 32 / 2048;
+
+  if (progress_cb)
+    progress_cb(total, total, 0, 0);
+
+  io_buf_free(buffer);
+  return 0;
+}
+
+// Times a compute stage over the benchmark buffer on the CCPLEX worker. The
+// histogram merge adds the first half of the buffer into the second half
+static u32 worker_bench_op(u32 op, u8 *buf, u32 arg, worker_cpl_t *cpl) {
+  worker_cmd_t cmd = {0};
+  cmd.op = op;
+  cmd.src = (u32)buf;
+  cmd.dst = (u32)buf;
+  cmd.size = WORKER_BENCH_SIZE;
+  cmd.arg = arg;
+  if (op == WORKER_OP_HIST_MERGE) {
+    cmd.size = WORKER_BENCH_SIZE / 2;
+    cmd.dst = (u32)buf + cmd.size;
+  }
+
+  u32 start_us = get_tmr_us();
+  for (u32 pass = 0; pass < WORKER_BENCH_PASSES; pass++) {
+    cmd.tag = pass;
+    if (worker_run(&cmd, cpl) || cpl->status)
+      return 0;
+  }
+  return sd_tester_get_kbps(WORKER_BENCH_SIZE / 512 * WORKER_BENCH_PASSES,
+                            get_tmr_us() - start_us);
+}
+
+static u32 bpmp_verify(const u32 *buf, u32 seed) {
+  u32 mismatches = 0;
+  for (u32 i = 0; i < WORKER_BENCH_SIZE / 4; i++)
+    if (buf[i] != WORKER_PATTERN(seed, i))
+      mismatches++;
+  return mismatches;
+}
+
+// Pattern fill, verify and CRC32 on the BPMP and on the CCPLEX worker. Each
+// core verifies the pattern the other one wrote, so the ring, the cache
+// maintenance and the pattern definition are checked as well.
+// Returns -2 without a worker image and -4 if the worker does not start
+int sd_tester_run_worker(sd_worker_result_t *result,
+                         void (*progress_cb)(u32 current, u32 total,
+                                             u32 latency, u32 errors)) {
+  memset(result, 0, sizeof(sd_worker_result_t));
+
+  int res = worker_start();
+  if (res)
+    return res == -2 ? -2 : -4;
+
+  u32 *buf = (u32 *)malloc(WORKER_BENCH_SIZE);
+  if (!buf) {
+    worker_stop();
+    return -1;
+  }
+
+  u32 total = WORKER_BENCH_MAX * 2;
+  u32 seed = get_tmr_us();
+  worker_cpl_t cpl;
+  u32 start_us, mismatches = 0;
+
+  // CCPLEX fills, BPMP verifies
+  result->ccplex_kbps[WORKER_BENCH_FILL] =
+      worker_bench_op(WORKER_OP_FILL, (u8 *)buf, seed, &cpl);
+  if (progress_cb)
+    progress_cb(1, total, 0, 0);
+
+  start_us = get_tmr_us();
+  for (u32 pass = 0; pass < WORKER_BENCH_PASSES; pass++)
+    mismatches += bpmp_verify(buf, seed);
+  result->bpmp_kbps[WORKER_BENCH_VERIFY] =
+      sd_tester_get_kbps(WORKER_BENCH_SIZE / 512 * WORKER_BENCH_PASSES,
+                         get_tmr_us() - start_us);
+  result->mismatches = mismatches / WORKER_BENCH_PASSES;
+  if (progress_cb)
+    progress_cb(2, total, 0, result->mismatches);
+
+  // BPMP fills, CCPLEX verifies
+  seed = ~seed;
+  start_us = get_tmr_us();
+  for (u32 pass = 0; pass < WORKER_BENCH_PASSES; pass++)
+    for (u32 i = 0; i < WORKER_BENCH_SIZE / 4; i++)
+      buf[i] = WORKER_PATTERN(seed, i);
+  result->bpmp_kbps[WORKER_BENCH_FILL] =
+      sd_tester_get_kbps(WORKER_BENCH_SIZE / 512 * WORKER_BENCH_PASSES,
+                         get_tmr_us() - start_us);
+  if (progress_cb)
+    progress_cb(3, total, 0, result->mismatches);
+
+  result->ccplex_kbps[WORKER_BENCH_VERIFY] =
+      worker_bench_op(WORKER_OP_VERIFY, (u8 *)buf, seed, &cpl);
+  result->mismatches += cpl.result;
+  if (progress_cb)
+    progress_cb(4, total, 0, result->mismatches);
+
+  // CRC32 of the same data on both
+  u32 crc = 0;
+  start_us = get_tmr_us();
+  for (u32 pass = 0; pass < WORKER_BENCH_PASSES; pass++)
+    crc = crc32_calc(0, (u8 *)buf, WORKER_BENCH_SIZE);
+  result->bpmp_kbps[WORKER_BENCH_CRC32] =
+      sd_tester_get_kbps(WORKER_BENCH_SIZE / 512 * WORKER_BENCH_PASSES,
+                         get_tmr_us() - start_us);
+  if (progress_cb)
+    progress_cb(5, total, 0, result->mismatches);
+
+  result->ccplex_kbps[WORKER_BENCH_CRC32] =
+      worker_bench_op(WORKER_OP_CRC32, (u8 *)buf, 0, &cpl);
+  result->crc_match = result->ccplex_kbps[WORKER_BENCH_CRC32] &&
+                      cpl.result == crc;
+  if (progress_cb)
+    progress_cb(6, total, 0, result->mismatches);
+
+  // Histogram merge, first half into the second half, on both. Each core
+  // adds the pattern bins once per pass, so the sum is checked at the end
+  u32 bins = WORKER_BENCH_SIZE / 8;
+  start_us = get_tmr_us();
+  for (u32 pass = 0; pass < WORKER_BENCH_PASSES; pass++)
+    for (u32 i = 0; i < bins; i++)
+      buf[bins + i] += buf[i];
+  result->bpmp_kbps[WORKER_BENCH_MERGE] =
+      sd_tester_get_kbps(WORKER_BENCH_SIZE / 512 * WORKER_BENCH_PASSES,
+                         get_tmr_us() - start_us);
+  if (progress_cb)
+    progress_cb(7, total, 0, result->mismatches);
+
+  result->ccplex_kbps[WORKER_BENCH_MERGE] =
+      worker_bench_op(WORKER_OP_HIST_MERGE, (u8 *)buf, 0, &cpl);
+  for (u32 i = 0; i < bins; i++)
+    if (buf[bins + i] != WORKER_PATTERN(seed, bins + i) +
+                             2 * WORKER_BENCH_PASSES * WORKER_PATTERN(seed, i))
+      result->mismatches++;
+  if (progress_cb)
+    progress_cb(total, total, 0, result->mismatches);
+
+  free(buf);
+  worker_stop();
   return 0;
 }
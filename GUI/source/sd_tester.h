@@ -10,8 +10,11 @@
 #ifndef _SD_TESTER_H_
 #define _SD_TESTER_H_
 
+#include <storage/sdmmc.h>
 #include <utils/types.h>
 
+#include "config.h"
+
 // Test mode enumeration
 typedef enum {
   TEST_SEQ_FAST, // Fast Sequential (512 MB)
@@ -20,42 +23,334 @@ typedef enum {
   TEST_BTF_FULL, // Full Butterfly (entire card)
   TEST_ALL_FAST, // Run both fast tests
   TEST_ALL_FULL, // Run both full tests
+  TEST_RND_QD,   // Random 4K reads at QD1 and max CMDQ depth
+  TEST_WR_CACHE, // Sequential writes with card cache off/on
+  TEST_ERASE,    // AU erase and discard throughput
+  TEST_TRACE,    // Per phase latency breakdown from driver trace
+  TEST_TAP_SCAN, // Read pass/fail across every sampling tap
+  TEST_INIT_PROF, // SD init time per step
+  TEST_DRIVE_SWEEP, // Driver type and power limit optimisation
+  TEST_DUAL,     // Concurrent SD and eMMC reads
+  TEST_BIS,      // emuMMC reads through BIS decryption and cache
+  TEST_WORKER,   // Compute stages on the BPMP vs the CCPLEX worker
 } test_mode_t;
 
+// Device the read tests run on. eMMC targets are only ever read.
+typedef enum {
+  TEST_DEV_SD,
+  TEST_DEV_EMMC_GPP,   // eMMC user area
+  TEST_DEV_EMMC_BOOT0, // eMMC boot partitions
+  TEST_DEV_EMMC_BOOT1,
+  TEST_DEV_MAX
+} test_dev_t;
+
 // Test result structure
 typedef struct {
   u32 blocks_tested;
   u32 blocks_passed;
   u32 read_errors;
+  u32 write_errors; // Write benchmarks only
   u32 slow_blocks;
   u32 min_latency_us;
   u32 max_latency_us;
   u64 total_latency_us;
 } sd_test_result_t;
 
+#define SURFACE_CELLS (SURFACE_COLS * SURFACE_ROWS)
+
+// Surface map classes, ordered so a cell only ever gets worse
+enum {
+  SURFACE_UNREAD,
+  SURFACE_FAST,  // < SURFACE_FAST_US
+  SURFACE_OK,    // < SURFACE_OK_US
+  SURFACE_SLOW,  // < SURFACE_SLOW_US
+  SURFACE_STALL,
+  SURFACE_ERROR,
+  SURFACE_CLASSES
+};
+
+// Live trend of a job for the progress charts. Memory is fixed whatever the
+// run length: each point covers one or more intervals
+typedef struct {
+  u32 kbps_min;
+  u32 kbps_max;
+  u32 p99_us; // Worst interval p99
+  u32 max_us; // Slowest single read
+} sd_trend_point_t;
+
+typedef struct {
+  u32 count;  // Points in use
+  u32 span;   // Intervals per point
+  u32 fill;   // Intervals in the last point
+  u32 serial; // Bumped per interval, for redraws
+  sd_trend_point_t points[TREND_POINTS];
+  u32 lba_max_us[TREND_LBA_POINTS]; // Worst latency per device slice
+  u32 slice_sectors;
+  u8 surface[SURFACE_CELLS];
+  u32 surface_dirty[SURFACE_CELLS / 32]; // Cells changed since last redraw
+  u32 cell_sectors;
+
+  // Interval being collected
+  u32 busy_us;
+  u32 sectors;
+  u32 ios;
+  u32 max_us;
+  u32 lat_bins[TREND_LAT_BINS];
+} sd_trend_t;
+
+// Sequential and butterfly reads as resumable jobs, advanced a time budget
+// at a time so the caller can keep the GUI responsive, pause or cancel
+typedef enum {
+  SD_JOB_SEQ,
+  SD_JOB_BTF,
+} sd_job_type_t;
+
+typedef struct {
+  u32 type;
+  sd_test_result_t *result;
+  u8 *buffer;
+  u32 pos;      // Sectors read (sequential) or iterations done (butterfly)
+  u32 total;    // Sectors or iterations to do
+  u32 low;      // Butterfly read pointers
+  u32 high;
+  u32 lat_low;  // Latest read latency (low end for butterfly)
+  u32 lat_high; // Latest butterfly high end latency
+  sd_trend_t *trend; // Optional, fed per read
+} sd_job_t;
+
+// Random I/O result structure
+typedef struct {
+  u32 queue_depth;
+  u32 elapsed_us;
+  sd_test_result_t io; // Per I/O latency statistics
+} sd_qd_result_t;
+
+// Write cache benchmark result structure
+typedef struct {
+  u32 cache_supported;
+  u32 sectors;         // Sectors written per pass
+  u32 nocache_us;      // Write time with cache disabled
+  u32 cache_us;        // Write time with cache enabled
+  u32 flush_us;        // Cache flush time after the cached pass
+  sd_test_result_t nocache; // Per write latency, cache disabled
+  sd_test_result_t cache;   // Per write latency, cache enabled
+} sd_cache_result_t;
+
+// Erase benchmark result structure
+typedef struct {
+  u32 au_sectors;        // Allocation unit used for alignment
+  u32 sectors;           // Sectors erased per pass
+  u32 discard_supported;
+  u32 erase_us;          // Total erase time
+  u32 discard_us;        // Total discard time
+  sd_test_result_t erase;   // Per AU erase latency
+  sd_test_result_t discard; // Per AU discard latency
+} sd_erase_result_t;
+
+// Average per I/O latency split by driver phase
+typedef struct {
+  u32 ios;          // Complete I/Os found in the trace
+  u32 dropped;      // Records overwritten before analysis
+  u32 issue_us;     // Entry to command issue (inhibit, DMA setup, cache clean)
+  u32 response_us;  // Command issue to response
+  u32 data_us;      // Response to transfer complete (includes auto CMD12)
+  u32 busy_us;      // Transfer complete to card not busy
+  u32 total_us;     // Entry to exit
+  u32 max_total_us;
+  u32 traced_us;    // Workload wall time with tracing on
+  u32 untraced_us;  // Same workload with tracing stopped
+} sd_trace_phase_t;
+
+// Trace benchmark result structure
+typedef struct {
+  sd_trace_phase_t seq; // 64 KB sequential reads
+  sd_trace_phase_t rnd; // 4 KB random reads
+} sd_trace_result_t;
+
+// Per tap read results
+typedef struct {
+  u8 reads;       // Reads attempted
+  u8 errors;      // Failed reads
+  u8 crc_errors;  // Failures flagged as CRC errors by the controller
+  u8 pad;
+  u32 kbps;       // Throughput of successful reads
+} sd_tap_result_t;
+
+// Tuning window scan result structure
+typedef struct {
+  u32 mode;       // SD bus mode the scan ran at
+  u32 tuned_tap;  // Tap selected by tuning
+  u32 win_start;  // Widest error free window
+  u32 win_size;
+  sd_tap_result_t taps[TAP_SCAN_TAPS];
+} sd_tap_scan_result_t;
+
+// One driver type / power limit setting
+typedef struct {
+  u8 supported; // Card reports support for both functions
+  u8 applied;   // Switch and re-tuning succeeded
+  u16 errors;   // Failed reads
+  u32 kbps;
+} sd_drive_point_t;
+
+// Driver type and power limit sweep result structure
+typedef struct {
+  u32 orig_drv_type;
+  u32 orig_pwr_limit;
+  u32 found;    // A stable setting was found
+  u32 best_drv_type;
+  u32 best_pwr_limit;
+  u32 best_kbps;
+  sd_drive_point_t points[4][DRIVE_SWEEP_PWR_LIMITS]; // [driver][power]
+} sd_drive_sweep_result_t;
+
+// One device in the concurrent read test
+typedef struct {
+  u32 elapsed_us;
+  u32 kbps;
+  sd_test_result_t io; // Per read latency statistics
+} sd_dual_dev_result_t;
+
+// Concurrent SD + eMMC read result structure
+typedef struct {
+  u32 reads;          // 64 KB reads per device per pass
+  sd_dual_dev_result_t sd_alone;
+  sd_dual_dev_result_t emmc_alone;
+  sd_dual_dev_result_t sd_shared;
+  sd_dual_dev_result_t emmc_shared;
+  u32 shared_us;      // Wall time of the interleaved pass
+  u32 aggregate_kbps; // Both devices over the interleaved pass
+} sd_dual_result_t;
+
 // SD card info structure
 typedef struct {
   u32 capacity_mb;
   u32 capacity_gb;
   u32 total_sectors;
   const char *speed_mode;
+  u32 cmdq_depth; // 0 if command queueing is not supported
+  u32 has_cache;
+  u32 bus_cfg_cached; // Init restored bus mode and tap without tuning
+  u32 init_ms;        // Last SD init duration
 } sd_card_info_t;
 
+// emuMMC BIS read paths and access patterns
+enum { BIS_PATH_RAW, BIS_PATH_XTS, BIS_PATH_CACHED, BIS_PATH_MAX };
+enum { BIS_PAT_SEQ, BIS_PAT_RND, BIS_PAT_MAX };
+
+// One emuMMC read pass
+typedef struct {
+  u32 kbps;
+  u32 errors;
+  u32 hits;      // Cluster cache statistics, cached path only
+  u32 misses;
+  u32 evictions;
+} sd_bis_pass_t;
+
+// emuMMC through BIS result structure
+typedef struct {
+  u32 gpp_sector; // emuMMC user area start on SD
+  u32 file_based;
+  u32 sectors;    // SYSTEM sectors covered by each pass
+  sd_bis_pass_t pass[BIS_PATH_MAX][BIS_PAT_MAX];
+  u32 replay_mb;        // Span of the cold reads in the replay
+  u32 replay_hot_mb;    // Hot set, smaller than BIS_REPLAY_HOT on a small span
+  sd_bis_pass_t replay; // Hot/cold mix through a bounded cache
+} sd_bis_result_t;
+
+// Compute stages timed on both cores
+enum {
+  WORKER_BENCH_FILL,
+  WORKER_BENCH_VERIFY,
+  WORKER_BENCH_CRC32,
+  WORKER_BENCH_MERGE,
+  WORKER_BENCH_MAX
+};
+
+typedef struct {
+  u32 bpmp_kbps[WORKER_BENCH_MAX];
+  u32 ccplex_kbps[WORKER_BENCH_MAX];
+  u32 mismatches; // Pattern words or merged bins the cores disagree on
+  u32 crc_match;
+} sd_worker_result_t;
+
+// eMMC info and EXT_CSD health structure
+typedef struct {
+  char prod_name[8];
+  u32 manfid;
+  u32 capacity_mb;
+  u32 boot_kb;       // Size of each boot partition
+  u32 cache_kb;
+  const char *speed_mode;
+  u8 ext_csd_rev;
+  u8 life_est_a;     // 0x01-0x0A: 0-100% used in 10% steps, 0x0B: exceeded
+  u8 life_est_b;
+  u8 pre_eol;        // 1: normal, 2: warning, 3: urgent
+} sd_emmc_health_t;
+
 // Function prototypes
 void sd_tester_init_result(sd_test_result_t *result);
 void sd_tester_get_card_info(sd_card_info_t *info);
 const char *sd_tester_get_speed_mode_string(u32 mode);
+void sd_tester_sync_bus_cfg(void);
+const char *sd_tester_get_init_step_string(u32 step);
+sd_init_prof_t *sd_tester_get_init_prof(void);
+int sd_tester_set_device(test_dev_t dev);
+test_dev_t sd_tester_get_device(void);
+const char *sd_tester_get_device_string(u32 dev);
+u32 sd_tester_get_device_sectors(void);
+int sd_tester_get_emmc_health(sd_emmc_health_t *health);
+void sd_tester_heap_mark(void);
+u32 sd_tester_heap_leaks(void);
+int sd_tester_heap_dump(void);
 
 // Test execution functions
+int sd_tester_job_seq(sd_job_t *job, sd_test_result_t *result,
+                      u32 sector_limit);
+int sd_tester_job_btf(sd_job_t *job, sd_test_result_t *result,
+                      u32 iterations);
+int sd_tester_job_step(sd_job_t *job, u32 budget_us);
+void sd_tester_job_end(sd_job_t *job);
+void sd_tester_trend_init(sd_trend_t *trend);
 int sd_tester_run_sequential(sd_test_result_t *result, u32 sector_limit,
                              void (*progress_cb)(u32 current, u32 total,
                                                  u32 latency, u32 errors));
 int sd_tester_run_butterfly(sd_test_result_t *result, u32 iterations,
                             void (*progress_cb)(u32 current, u32 total,
                                                 u32 lat_low, u32 lat_high));
+int sd_tester_run_random_qd(sd_qd_result_t *result, u32 ios, u32 queue_depth,
+                            void (*progress_cb)(u32 current, u32 total,
+                                                u32 latency, u32 errors));
+int sd_tester_run_write_cache(sd_cache_result_t *result,
+                              void (*progress_cb)(u32 current, u32 total,
+                                                  u32 latency, u32 errors));
+int sd_tester_run_erase(sd_erase_result_t *result,
+                        void (*progress_cb)(u32 current, u32 total,
+                                            u32 latency, u32 errors));
+int sd_tester_run_trace(sd_trace_result_t *result,
+                        void (*progress_cb)(u32 current, u32 total,
+                                            u32 latency, u32 errors));
+int sd_tester_run_tap_scan(sd_tap_scan_result_t *result,
+                           void (*progress_cb)(u32 current, u32 total,
+                                               u32 latency, u32 errors));
+int sd_tester_run_drive_sweep(sd_drive_sweep_result_t *result,
+                              void (*progress_cb)(u32 current, u32 total,
+                                                  u32 latency, u32 errors));
+int sd_tester_apply_drive(u32 drv_type, u32 pwr_limit, int persist);
+int sd_tester_run_dual(sd_dual_result_t *result,
+                       void (*progress_cb)(u32 current, u32 total,
+                                           u32 latency, u32 errors));
+int sd_tester_run_bis(sd_bis_result_t *result,
+                      void (*progress_cb)(u32 current, u32 total,
+                                          u32 latency, u32 errors));
+int sd_tester_run_worker(sd_worker_result_t *result,
+                         void (*progress_cb)(u32 current, u32 total,
+                                             u32 latency, u32 errors));
 
 // Result helpers
 u32 sd_tester_get_avg_latency(sd_test_result_t *result);
 int sd_tester_is_passed(sd_test_result_t *result);
+u32 sd_tester_get_iops(sd_qd_result_t *result);
+u32 sd_tester_get_kbps(u32 sectors, u32 elapsed_us);
 
 #endif
@@ -0,0 +1,49 @@
+/*
+ * SD Card Read Tester - LZ4 stub handoff
+ * Copyright (c) 2026
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+// make packed links the payload to run from DRAM and wraps it in a stub that
+// stays in IRAM. The stub brings up DRAM with hw_init, unpacks the image and
+// jumps to it, leaving its timings behind for the payload to report
+
+#ifndef _STUB_H_
+#define _STUB_H_
+
+#include <memory_map.h>
+#include <utils/types.h>
+
+// Must match STUB_IMAGE_ADDR in the Makefile. The last 4 KB hold the info
+#define STUB_IMAGE_ADDR NYX_LOAD_ADDR
+#define  STUB_IMAGE_SZ_MAX (NYX_SZ_MAX - SZ_4K)
+#define STUB_INFO_ADDR (STUB_IMAGE_ADDR + STUB_IMAGE_SZ_MAX)
+
+#define STUB_PACK_MAGIC 0x50345A4C // "LZ4P"
+#define STUB_INFO_MAGIC 0x464E4953 // "SINF"
+
+// Packed image header, written by tools/lz4pack. One LZ4 block follows
+typedef struct _stub_pack_hdr_t {
+  u32 magic;
+  u32 raw_size;
+  u32 packed_size;
+  u32 rsvd;
+} stub_pack_hdr_t;
+
+typedef struct _stub_info_t {
+  u32 magic;
+  u32 raw_size;
+  u32 packed_size; // LZ4 block only, the stub binary adds its own code
+  u32 hw_init_us;
+  u32 unpack_us;
+} stub_info_t;
+
+static inline const stub_info_t *stub_get_info(void) {
+  const stub_info_t *info = (const stub_info_t *)STUB_INFO_ADDR;
+  return info->magic == STUB_INFO_MAGIC ? info : NULL;
+}
+
+#endif
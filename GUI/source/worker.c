@@ -0,0 +1,136 @@
+/*
+ * SD Card Read Tester - CCPLEX worker client
+ * Copyright (c) 2026
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+// Boots the AArch64 worker (worker/) on CPU0 and exchanges commands with it
+// through the shared ring. The BPMP keeps the GUI and SDMMC control, the
+// worker only touches the buffers named in its commands.
+
+#include <mem/heap.h>
+#include <memory_map.h>
+#include <soc/bpmp.h>
+#include <soc/ccplex.h>
+#include <soc/timer.h>
+#include <storage/sd.h>
+#include <string.h>
+
+#include "config.h"
+#include "worker.h"
+
+static worker_ring_t *ring = (worker_ring_t *)WORKER_RING_ADDR;
+static bool worker_running = false;
+static bool ring_uncached = false;
+
+// Takes the ring out of the BPMP cache. The DRAM entry is split around it and
+// the ring falls to the uncached fallback entry.
+static void ring_uncache(void) {
+  static const bpmp_mmu_entry_t dram_low = {
+      DRAM_START, WORKER_RING_ADDR - 1,
+      MMU_EN_READ | MMU_EN_WRITE | MMU_EN_EXEC | MMU_EN_CACHED, true};
+  static const bpmp_mmu_entry_t dram_high = {
+      WORKER_RING_ADDR + WORKER_RING_SZ, 0xFFFFFFFF,
+      MMU_EN_READ | MMU_EN_WRITE | MMU_EN_EXEC | MMU_EN_CACHED, true};
+
+  if (ring_uncached)
+    return;
+
+  bpmp_mmu_set_entry(0, &dram_low, false);
+  bpmp_mmu_set_entry(WORKER_MMU_ENTRY, &dram_high, true);
+  bpmp_mmu_maintenance(BPMP_MMU_MAINT_CLN_INV_WAY, false);
+  ring_uncached = true;
+}
+
+// Loads the worker image from the SD and waits for it to poll the ring.
+// Returns -2 if there is no worker image
+int worker_start(void) {
+  if (worker_running)
+    return 0;
+
+  u32 size = 0;
+  void *image = sd_file_read(WORKER_FILE, &size);
+  if (!image)
+    return -2;
+  if (size > WORKER_IMAGE_SZ) {
+    free(image);
+    return -2;
+  }
+
+  memcpy((void *)WORKER_LOAD_ADDR, image, size);
+  free(image);
+
+  ring_uncache();
+  memset(ring, 0, sizeof(worker_ring_t));
+  ring->magic = WORKER_RING_MAGIC;
+
+  ccplex_boot_cpu0(WORKER_LOAD_ADDR, false);
+
+  u32 timeout = get_tmr_ms() + WORKER_TIMEOUT_MS;
+  while (ring->state != WORKER_STATE_READY) {
+    if (get_tmr_ms() > timeout) {
+      ccplex_powergate_cpu0();
+      return -1;
+    }
+  }
+
+  worker_running = true;
+  return 0;
+}
+
+void worker_stop(void) {
+  if (!worker_running)
+    return;
+
+  worker_cmd_t cmd = {0};
+  cmd.op = WORKER_OP_EXIT;
+  worker_cpl_t cpl;
+  worker_run(&cmd, &cpl);
+
+  // Let it reach WFI before pulling power
+  u32 timeout = get_tmr_ms() + WORKER_TIMEOUT_MS;
+  while (ring->state != WORKER_STATE_EXITED && get_tmr_ms() < timeout)
+    ;
+
+  ccplex_powergate_cpu0();
+  worker_running = false;
+}
+
+// Queues a command. Returns 0 if the ring is full
+int worker_submit(const worker_cmd_t *cmd) {
+  return worker_ring_push_cmd(ring, cmd);
+}
+
+// Takes the next completion if there is one
+int worker_poll(worker_cpl_t *cpl) {
+  if (!worker_ring_pop_cpl(ring, cpl))
+    return 0;
+
+  // The worker may have written buffers the BPMP has cached. The cache is
+  // write through, so invalidating loses nothing.
+  bpmp_mmu_maintenance(BPMP_MMU_MAINT_INVALID_WAY, false);
+  return 1;
+}
+
+// Runs one command and waits for it. Commands already queued complete first
+int worker_run(const worker_cmd_t *cmd, worker_cpl_t *cpl) {
+  if (!worker_running)
+    return -2;
+
+  while (!worker_submit(cmd))
+    ;
+
+  u32 timeout = get_tmr_ms() + WORKER_TIMEOUT_MS;
+  while (1) {
+    if (worker_poll(cpl)) {
+      if (cpl->tag == cmd->tag)
+        return 0;
+      timeout = get_tmr_ms() + WORKER_TIMEOUT_MS;
+    } else if (get_tmr_ms() > timeout) {
+      return -1;
+    }
+  }
+}
@@ -0,0 +1,23 @@
+/*
+ * SD Card Read Tester - CCPLEX worker client
+ * Copyright (c) 2026
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#ifndef _WORKER_H_
+#define _WORKER_H_
+
+#include <utils/types.h>
+
+#include "worker_ring.h"
+
+int worker_start(void);
+void worker_stop(void);
+int worker_submit(const worker_cmd_t *cmd);
+int worker_poll(worker_cpl_t *cpl);
+int worker_run(const worker_cmd_t *cmd, worker_cpl_t *cpl);
+
+#endif
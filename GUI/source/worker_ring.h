@@ -0,0 +1,158 @@
+/*
+ * SD Card Read Tester - CCPLEX worker command ring
+ * Copyright (c) 2026
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+// Shared by the BPMP client, the AArch64 worker and host stand-ins, so it
+// only depends on utils/types.h. Two single producer/single consumer rings:
+// the BPMP produces commands, the worker produces completions. Indices run
+// free and are masked on access, each one is written by one side only
+
+#ifndef _WORKER_RING_H_
+#define _WORKER_RING_H_
+
+#include <utils/types.h>
+
+// Worker image and ring live in the mixed SDMMC DMA window (MIXD_BUF_ALIGNED).
+// The ring has a 2 MB block to itself, so both sides can map it uncached
+#define WORKER_LOAD_ADDR 0xF0000000
+#define  WORKER_IMAGE_SZ   0x100000 // Code, data, page tables and stack
+#define WORKER_RING_ADDR 0xF0200000
+#define  WORKER_RING_SZ    0x200000
+
+#define WORKER_RING_MAGIC 0x474E5257 // "WRNG"
+#define WORKER_RING_SLOTS 64         // Power of 2
+#define WORKER_RING_LINE  64         // Largest cache line of both sides
+
+// Verify/fill pattern. A Weyl sequence per 32-bit word, easy to vectorize
+#define WORKER_PATTERN(seed, word) ((seed) + (word) * 0x9E3779B9)
+
+enum {
+  WORKER_STATE_OFF    = 0,
+  WORKER_STATE_READY  = 1, // Set by the worker once it polls the ring
+  WORKER_STATE_EXITED = 2,
+};
+
+typedef enum {
+  WORKER_OP_NOP        = 0,
+  WORKER_OP_FILL       = 1, // Fill dst with the pattern of seed arg
+  WORKER_OP_VERIFY     = 2, // Compare src with the pattern of seed arg
+  WORKER_OP_CRC32      = 3, // CRC32 of src, arg is the running CRC
+  WORKER_OP_HIST_MERGE = 4, // Add the u32 bins of src into dst
+  WORKER_OP_EXIT       = 5,
+} worker_op_t;
+
+enum {
+  WORKER_OK        =  0,
+  WORKER_ERR_OP    = -1,
+  WORKER_ERR_ALIGN = -2, // Buffers and sizes must be 16 byte aligned
+};
+
+typedef struct _worker_cmd_t {
+  u32 op;
+  u32 tag;  // Returned in the completion
+  u32 src;
+  u32 dst;
+  u32 size; // Bytes
+  u32 arg;
+  u32 rsvd[2];
+} worker_cmd_t;
+
+typedef struct _worker_cpl_t {
+  u32 tag;
+  s32 status;
+  u32 result; // CRC32 or mismatching words
+  u32 detail; // Byte offset of the first mismatch, 0xFFFFFFFF if none
+} worker_cpl_t;
+
+typedef struct _worker_ring_t {
+  u32 magic;
+  volatile u32 state;
+  u8  rsvd0[WORKER_RING_LINE - 8];
+
+  volatile u32 cmd_head; // Written by the BPMP
+  u8  rsvd1[WORKER_RING_LINE - 4];
+  volatile u32 cmd_tail; // Written by the worker
+  u8  rsvd2[WORKER_RING_LINE - 4];
+  volatile u32 cpl_head; // Written by the worker
+  u8  rsvd3[WORKER_RING_LINE - 4];
+  volatile u32 cpl_tail; // Written by the BPMP
+  u8  rsvd4[WORKER_RING_LINE - 4];
+
+  worker_cmd_t cmd[WORKER_RING_SLOTS];
+  worker_cpl_t cpl[WORKER_RING_SLOTS];
+} worker_ring_t;
+
+// Orders slot accesses against index updates. The BPMP is in order and maps
+// the ring uncached, so it only needs a compiler barrier
+#ifndef WORKER_BARRIER
+#ifdef __aarch64__
+#define WORKER_BARRIER() __asm__ volatile("dmb sy" ::: "memory")
+#else
+#define WORKER_BARRIER() __asm__ volatile("" ::: "memory")
+#endif
+#endif
+
+static inline int worker_ring_push_cmd(worker_ring_t *ring,
+                                       const worker_cmd_t *cmd) {
+  u32 head = ring->cmd_head;
+
+  if (head - ring->cmd_tail >= WORKER_RING_SLOTS)
+    return 0;
+
+  ring->cmd[head & (WORKER_RING_SLOTS - 1)] = *cmd;
+  WORKER_BARRIER(); // Slot is written before it is published
+  ring->cmd_head = head + 1;
+
+  return 1;
+}
+
+static inline int worker_ring_pop_cmd(worker_ring_t *ring,
+                                      worker_cmd_t *cmd) {
+  u32 tail = ring->cmd_tail;
+
+  if (tail == ring->cmd_head)
+    return 0;
+
+  WORKER_BARRIER(); // Slot is read after the head that published it
+  *cmd = ring->cmd[tail & (WORKER_RING_SLOTS - 1)];
+  WORKER_BARRIER(); // Slot is read before it is handed back
+  ring->cmd_tail = tail + 1;
+
+  return 1;
+}
+
+static inline int worker_ring_push_cpl(worker_ring_t *ring,
+                                       const worker_cpl_t *cpl) {
+  u32 head = ring->cpl_head;
+
+  if (head - ring->cpl_tail >= WORKER_RING_SLOTS)
+    return 0;
+
+  ring->cpl[head & (WORKER_RING_SLOTS - 1)] = *cpl;
+  WORKER_BARRIER();
+  ring->cpl_head = head + 1;
+
+  return 1;
+}
+
+static inline int worker_ring_pop_cpl(worker_ring_t *ring,
+                                      worker_cpl_t *cpl) {
+  u32 tail = ring->cpl_tail;
+
+  if (tail == ring->cpl_head)
+    return 0;
+
+  WORKER_BARRIER();
+  *cpl = ring->cpl[tail & (WORKER_RING_SLOTS - 1)];
+  WORKER_BARRIER();
+  ring->cpl_tail = tail + 1;
+
+  return 1;
+}
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * SD Card Read Tester - LZ4 unpacking stub
+ * Copyright (c) 2026
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+// Runs from IRAM like any payload. Brings up the hardware and DRAM, unpacks
+// the payload image to STUB_IMAGE_ADDR and jumps to its _start. The payload
+// is built with SD_TESTER_STUB and skips its own hw_init.
+
+#include <string.h>
+
+#include <bdk.h>
+#include <libs/compr/lz4.h>
+
+#include "stub.h"
+
+// Packed image, see payload.S
+extern const u8 _payload_start[];
+
+// hw_init stamps the SD power off time here. Normally owned by sdmmc.c, which
+// the stub does not link
+u32 sd_power_cycle_time_start;
+
+void ipl_main(void) {
+  u32 entry_us = get_tmr_us();
+
+  hw_init();
+  u32 hw_us = get_tmr_us();
+
+  // A bad image resets through panic, power_set_state would pull in the
+  // whole storage stack
+  const stub_pack_hdr_t *hdr = (const stub_pack_hdr_t *)_payload_start;
+  if (hdr->magic != STUB_PACK_MAGIC || hdr->raw_size > STUB_IMAGE_SZ_MAX)
+    panic(STUB_PACK_MAGIC);
+
+  int size = LZ4_decompress_safe((const char *)(hdr + 1),
+                                 (char *)STUB_IMAGE_ADDR, hdr->packed_size,
+                                 STUB_IMAGE_SZ_MAX);
+  if (size < 0 || (u32)size != hdr->raw_size)
+    panic(STUB_PACK_MAGIC);
+
+  stub_info_t *info = (stub_info_t *)STUB_INFO_ADDR;
+  info->raw_size = hdr->raw_size;
+  info->packed_size = hdr->packed_size;
+  info->hw_init_us = hw_us - entry_us;
+  info->unpack_us = get_tmr_us() - hw_us;
+  info->magic = STUB_INFO_MAGIC;
+
+  // The image was written through the data side, make sure no stale lines
+  // of that range are fetched as code
+  bpmp_mmu_maintenance(BPMP_MMU_MAINT_CLN_INV_WAY, false);
+
+  void (*image_start)(void) = (void *)STUB_IMAGE_ADDR;
+  image_start();
+}
@@ -0,0 +1,355 @@
+/*
+ * SD Card Read Tester - BIS cluster cache replay benchmark (host tool)
+ * Copyright (c) 2026
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+// Replays an access trace through the CLOCK cache of bdk/storage/nx_emmc_bis.c
+// and through the linear fill cache it replaced, on a simulated eMMC. Reports
+// hit rate, evictions and write-back batches per policy, and checks every read
+// and the device contents after the final flush against what was written.
+//
+// Trace: one access per line, "r <sector> <count>" or "w <sector> <count>",
+// sectors relative to the partition. '#' starts a comment. Without a trace,
+// -s generates the hot/cold mix of the on-device replay, with writes added.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <storage/nx_emmc_bis.h>
+#include <utils/types.h>
+
+#include "config.h"
+
+// Linear fill baseline, renamed at build time, see Makefile
+void linear_bis_init(emmc_part_t *part, bool enable_cache, u32 emummc_offset);
+int linear_bis_read(u32 sector, u32 count, void *buff);
+int linear_bis_write(u32 sector, u32 count, void *buff);
+void linear_bis_end();
+void linear_bis_get_stats(nx_emmc_bis_stats_t *stats);
+
+// Private to nx_emmc_bis.c
+#define CLUSTER_SECTORS 32
+#define CLUSTER_SIZE 16384
+#define CACHE_ENTRIES_MIN 64    // BIS_WRITEBACK_BATCH
+#define CACHE_ENTRIES_MAX 16384 // BIS_CACHE_MAX_ENTRIES
+
+#define LOOKUP_CLUSTERS_MAX (32u << 20) // 512 GB partition, as on the device
+#define ACCESS_SECTORS_MAX 1024
+#define SYNTH_WRITE_PCT 10
+
+// Cache entries carry their flags next to the cluster data
+u8 bis_host_cache[(CACHE_ENTRIES_MAX + 1) * (CLUSTER_SIZE + 64)]
+    __attribute__((aligned(64)));
+u32 bis_host_lookup[LOOKUP_CLUSTERS_MAX];
+sdmmc_storage_t sd_storage;
+u32 linear_cache_entries;
+
+typedef struct {
+  u8 write;
+  u16 count;
+  u32 sector;
+} access_t;
+
+typedef struct {
+  const char *name;
+  void (*init)(emmc_part_t *part, bool enable_cache, u32 emummc_offset);
+  int (*read)(u32 sector, u32 count, void *buff);
+  int (*write)(u32 sector, u32 count, void *buff);
+  void (*end)(void);
+  void (*get_stats)(nx_emmc_bis_stats_t *stats);
+} policy_t;
+
+// Simulated device. Only the first word of every sector is kept, written
+// accesses stamp it with a new generation
+typedef struct {
+  u64 read_sectors;
+  u64 write_sectors;
+  u32 writebacks;
+  u32 batches;    // Write-backs issued by one cache call
+  u32 batch_max;
+  u32 backwards;  // Write-backs below the previous one of their batch
+  u32 batch_cnt;
+  u32 batch_lba;
+  bool trace_write; // Writes of the trace itself, not write-backs
+} dev_stats_t;
+
+static u32 *dev_tag, *want_tag;
+static u32 part_sectors;
+static dev_stats_t dev;
+
+static const policy_t policies[] = {
+    {"clock", nx_emmc_bis_init, nx_emmc_bis_read, nx_emmc_bis_write,
+     nx_emmc_bis_end, nx_emmc_bis_get_stats},
+    {"linear", linear_bis_init, linear_bis_read, linear_bis_write,
+     linear_bis_end, linear_bis_get_stats},
+};
+
+static u32 rng_state = 1;
+
+static u32 rng_next(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+int emmc_part_read(emmc_part_t *part, u32 sector_off, u32 num_sectors,
+                   void *buf) {
+  if (sector_off + num_sectors > part_sectors)
+    return 0;
+
+  for (u32 i = 0; i < num_sectors; i++)
+    *(u32 *)((u8 *)buf + i * EMMC_BLOCKSIZE) = dev_tag[sector_off + i];
+  dev.read_sectors += num_sectors;
+
+  return 1;
+}
+
+int emmc_part_write(emmc_part_t *part, u32 sector_off, u32 num_sectors,
+                    void *buf) {
+  if (sector_off + num_sectors > part_sectors)
+    return 0;
+
+  for (u32 i = 0; i < num_sectors; i++)
+    dev_tag[sector_off + i] = *(u32 *)((u8 *)buf + i * EMMC_BLOCKSIZE);
+  dev.write_sectors += num_sectors;
+
+  if (!dev.trace_write) {
+    dev.writebacks++;
+    if (!dev.batch_cnt)
+      dev.batches++;
+    else if (sector_off < dev.batch_lba)
+      dev.backwards++;
+    dev.batch_cnt++;
+    dev.batch_lba = sector_off;
+    if (dev.batch_cnt > dev.batch_max)
+      dev.batch_max = dev.batch_cnt;
+  }
+
+  return 1;
+}
+
+// Replay uses no emuMMC offset, so the SD is never accessed
+int sdmmc_storage_read(sdmmc_storage_t *storage, u32 sector, u32 num_sectors,
+                       void *buf) {
+  return 0;
+}
+
+int sdmmc_storage_write(sdmmc_storage_t *storage, u32 sector, u32 num_sectors,
+                        void *buf) {
+  return 0;
+}
+
+// XTS is a plain copy, the cache only has to move the data around
+int se_aes_xts_crypt_sec_nx(u32 tweak_ks, u32 crypt_ks, u32 enc, u64 sec,
+                            u8 *tweak, bool regen_tweak, u32 tweak_exp,
+                            void *dst, void *src, u32 sec_size) {
+  memmove(dst, src, sec_size);
+  return 1;
+}
+
+static access_t *load_trace(const char *path, u32 *cnt) {
+  FILE *fp = fopen(path, "r");
+  if (!fp)
+    return NULL;
+
+  u32 size = 4096;
+  access_t *trace = malloc(size * sizeof(access_t));
+  char line[128];
+  u32 n = 0, line_no = 0;
+
+  while (trace && fgets(line, sizeof(line), fp)) {
+    line_no++;
+    char op;
+    unsigned long sector, count;
+    char *p = line + strspn(line, " \t");
+    if (*p == '#' || *p == '\n' || !*p)
+      continue;
+
+    if (sscanf(p, "%c %lu %lu", &op, &sector, &count) != 3 ||
+        (op != 'r' && op != 'w') || !count || count > ACCESS_SECTORS_MAX ||
+        sector + count > (u64)LOOKUP_CLUSTERS_MAX * CLUSTER_SECTORS) {
+      fprintf(stderr, "bisreplay: %s:%u: bad access\n", path, line_no);
+      free(trace);
+      trace = NULL;
+      break;
+    }
+
+    if (n == size) {
+      size *= 2;
+      access_t *grown = realloc(trace, size * sizeof(access_t));
+      if (!grown) {
+        free(trace);
+        trace = NULL;
+        break;
+      }
+      trace = grown;
+    }
+    trace[n++] = (access_t){op == 'w', count, sector};
+  }
+  fclose(fp);
+
+  *cnt = n;
+  return trace;
+}
+
+// Same mix as bis_replay in sd_tester.c: 4 KB accesses, 80% into the first
+// BIS_REPLAY_HOT clusters of BIS_BENCH_SECTORS
+static access_t *synth_trace(u32 cnt) {
+  access_t *trace = malloc(cnt * sizeof(access_t));
+  if (!trace)
+    return NULL;
+
+  u32 span_clusters = BIS_BENCH_SECTORS / CLUSTER_SECTORS;
+  for (u32 i = 0; i < cnt; i++) {
+    u32 r = rng_next();
+    u32 cluster = (r & 0xFF) < 205 ? (r >> 8) % BIS_REPLAY_HOT
+                                   : (r >> 8) % span_clusters;
+    trace[i].sector =
+        cluster * CLUSTER_SECTORS + (rng_next() % 4) * RANDOM_IO_SECTORS;
+    trace[i].count = RANDOM_IO_SECTORS;
+    trace[i].write = rng_next() % 100 < SYNTH_WRITE_PCT;
+  }
+
+  return trace;
+}
+
+// Returns the number of stale reads and lost writes
+static u32 replay(const policy_t *pol, const access_t *trace, u32 cnt,
+                  u8 *buf) {
+  static u32 gen = 0x80000000;
+
+  for (u32 i = 0; i < part_sectors; i++)
+    dev_tag[i] = want_tag[i] = i;
+  memset(&dev, 0, sizeof(dev));
+
+  emmc_part_t part = {0};
+  part.lba_end = part_sectors - 1;
+  strcpy(part.name, "SYSTEM");
+  pol->init(&part, true, 0);
+
+  u32 stale = 0, failed = 0;
+  for (u32 i = 0; i < cnt; i++) {
+    const access_t *a = &trace[i];
+    dev.batch_cnt = 0;
+
+    if (a->write) {
+      for (u32 s = 0; s < a->count; s++) {
+        *(u32 *)(buf + s * EMMC_BLOCKSIZE) = ++gen;
+        want_tag[a->sector + s] = gen;
+      }
+      dev.trace_write = true;
+      failed += !pol->write(a->sector, a->count, buf);
+      dev.trace_write = false;
+    } else {
+      if (!pol->read(a->sector, a->count, buf)) {
+        failed++;
+        continue;
+      }
+      for (u32 s = 0; s < a->count; s++)
+        if (*(u32 *)(buf + s * EMMC_BLOCKSIZE) != want_tag[a->sector + s])
+          stale++;
+    }
+  }
+
+  nx_emmc_bis_stats_t stats;
+  pol->get_stats(&stats);
+  dev.batch_cnt = 0;
+  pol->end();
+
+  u32 lost = 0;
+  for (u32 i = 0; i < part_sectors; i++)
+    if (dev_tag[i] != want_tag[i])
+      lost++;
+
+  u32 lookups = stats.hits + stats.misses;
+  printf("%-6s: hits %u.%u%% (%u of %u), evictions %u, eMMC read %llu MB\n",
+         pol->name, (u32)((u64)stats.hits * 1000 / MAX(lookups, 1)) / 10,
+         (u32)((u64)stats.hits * 1000 / MAX(lookups, 1)) % 10, stats.hits,
+         lookups, stats.evictions,
+         (unsigned long long)(dev.read_sectors * EMMC_BLOCKSIZE >> 20));
+  printf("        write-backs %u in %u batches (max %u, %u out of LBA order), "
+         "eMMC written %llu MB\n",
+         dev.writebacks, dev.batches, dev.batch_max, dev.backwards,
+         (unsigned long long)(dev.write_sectors * EMMC_BLOCKSIZE >> 20));
+  if (stale || lost || failed)
+    printf("        %u stale sectors read, %u written sectors lost, %u "
+           "failed accesses\n",
+           stale, lost, failed);
+
+  return stale + lost + failed;
+}
+
+int main(int argc, char **argv) {
+  u32 entries = BIS_REPLAY_CACHE;
+  u32 synth = 0;
+  const char *path = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-c") && i + 1 < argc)
+      entries = strtoul(argv[++i], NULL, 0);
+    else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+      synth = strtoul(argv[++i], NULL, 0);
+    else if (argv[i][0] != '-' && !path)
+      path = argv[i];
+    else
+      path = NULL, synth = 0, i = argc;
+  }
+
+  if ((!path == !synth) || entries < CACHE_ENTRIES_MIN ||
+      entries > CACHE_ENTRIES_MAX) {
+    fprintf(stderr,
+            "Usage: %s [-c entries] <trace> | [-c entries] -s <accesses>\n"
+            "  entries: %u to %u clusters, default %u\n",
+            argv[0], CACHE_ENTRIES_MIN, CACHE_ENTRIES_MAX, BIS_REPLAY_CACHE);
+    return 1;
+  }
+
+  u32 cnt = synth;
+  access_t *trace = path ? load_trace(path, &cnt) : synth_trace(synth);
+  if (!trace || !cnt) {
+    fprintf(stderr, "bisreplay: no accesses to replay\n");
+    return 1;
+  }
+
+  // Partition covers the highest access, in whole clusters
+  u32 top = 0;
+  for (u32 i = 0; i < cnt; i++)
+    top = MAX(top, trace[i].sector + trace[i].count);
+  part_sectors = ALIGN(top, CLUSTER_SECTORS);
+
+  dev_tag = malloc(part_sectors * sizeof(u32));
+  want_tag = malloc(part_sectors * sizeof(u32));
+  u8 *buf = malloc(ACCESS_SECTORS_MAX * EMMC_BLOCKSIZE);
+  if (!dev_tag || !want_tag || !buf) {
+    fprintf(stderr, "bisreplay: out of memory\n");
+    return 1;
+  }
+
+  u32 writes = 0;
+  for (u32 i = 0; i < cnt; i++)
+    writes += trace[i].write;
+  printf("%u accesses (%u writes) over %u MB, cache %u clusters (%u MB)\n",
+         cnt, writes, part_sectors / 2048, entries,
+         entries * CLUSTER_SIZE >> 20);
+
+  nx_emmc_bis_set_cache_limit(entries);
+  linear_cache_entries = entries;
+
+  // The linear baseline drops dirty clusters on a full flush, so only the
+  // CLOCK cache has to come out clean
+  int res = replay(&policies[0], trace, cnt, buf) ? 1 : 0;
+  replay(&policies[1], trace, cnt, buf);
+
+  free(buf);
+  free(want_tag);
+  free(dev_tag);
+  free(trace);
+
+  return res;
+}
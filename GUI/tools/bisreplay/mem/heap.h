@@ -0,0 +1,8 @@
+/*
+ * Host stand-in for the BDK heap header. The BIS driver does not allocate
+ */
+
+#ifndef _HEAP_H_
+#define _HEAP_H_
+
+#endif
@@ -0,0 +1,17 @@
+/*
+ * Host stand-in for the BDK memory map. The BIS cache and its lookup table
+ * live in arrays of bisreplay.c instead of fixed DRAM carveouts
+ */
+
+#ifndef _MEMORY_MAP_H_
+#define _MEMORY_MAP_H_
+
+#include <utils/types.h>
+
+extern u8  bis_host_cache[];
+extern u32 bis_host_lookup[];
+
+#define NX_BIS_CACHE_ADDR  bis_host_cache
+#define NX_BIS_LOOKUP_ADDR bis_host_lookup
+
+#endif
@@ -0,0 +1,18 @@
+/*
+ * Host stand-in for the BDK SE header. XTS is replaced by a plain copy, see
+ * bisreplay.c
+ */
+
+#ifndef _SE_H_
+#define _SE_H_
+
+#include <utils/types.h>
+
+#define SE_KEY_128_SIZE 16
+
+#define DECRYPT 0
+#define ENCRYPT 1
+
+int se_aes_xts_crypt_sec_nx(u32 tweak_ks, u32 crypt_ks, u32 enc, u64 sec, u8 *tweak, bool regen_tweak, u32 tweak_exp, void *dst, void *src, u32 sec_size);
+
+#endif
@@ -0,0 +1,26 @@
+/*
+ * Host stand-in for the BDK eMMC header. Partition reads and writes go to the
+ * simulated device of bisreplay.c
+ */
+
+#ifndef _EMMC_H_
+#define _EMMC_H_
+
+#include <storage/sdmmc.h>
+#include <utils/types.h>
+
+#define EMMC_BLOCKSIZE SDMMC_DAT_BLOCKSIZE
+
+typedef struct _emmc_part_t
+{
+	u32 index;
+	u32 lba_start;
+	u32 lba_end;
+	u64 attrs;
+	char name[37];
+} emmc_part_t;
+
+int emmc_part_read(emmc_part_t *part, u32 sector_off, u32 num_sectors, void *buf);
+int emmc_part_write(emmc_part_t *part, u32 sector_off, u32 num_sectors, void *buf);
+
+#endif
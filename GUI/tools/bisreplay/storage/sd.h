@@ -0,0 +1,13 @@
+/*
+ * Host stand-in for the BDK SD header. The replay always reads eMMC, so the
+ * SD storage is never used
+ */
+
+#ifndef SD_H
+#define SD_H
+
+#include <storage/sdmmc.h>
+
+extern sdmmc_storage_t sd_storage;
+
+#endif
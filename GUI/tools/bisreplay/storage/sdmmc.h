@@ -0,0 +1,21 @@
+/*
+ * Host stand-in for the BDK SDMMC header. Only the storage calls the BIS
+ * driver makes, backed by bisreplay.c
+ */
+
+#ifndef _SDMMC_H_
+#define _SDMMC_H_
+
+#include <utils/types.h>
+
+#define SDMMC_DAT_BLOCKSIZE 512
+
+typedef struct _sdmmc_storage_t
+{
+	u32 sec_cnt;
+} sdmmc_storage_t;
+
+int sdmmc_storage_read(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf);
+int sdmmc_storage_write(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf);
+
+#endif
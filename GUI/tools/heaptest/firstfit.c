@@ -0,0 +1,32 @@
+/*
+ * SD Card Read Tester - First-fit baseline heap (host tool)
+ * Copyright (c) 2026
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+// Builds the vendored first-fit heap under ff_ names (see Makefile) and adds
+// the stats heap_get_stats reports for the current heap, from a node walk.
+
+#include "firstfit/heap.c"
+
+void ff_heap_get_stats(u32 *used, u32 *free_bytes, u32 *largest_free,
+                       u32 *top) {
+  *used = *free_bytes = *largest_free = *top = 0;
+
+  for (hnode_t *node = _heap.first; node; node = node->next) {
+    if (node->used) {
+      *used += node->size + sizeof(hnode_t);
+    } else {
+      *free_bytes += node->size + sizeof(hnode_t);
+      if (node->size > *largest_free)
+        *largest_free = node->size;
+    }
+  }
+
+  if (_heap.last)
+    *top = (void *)_heap.last + sizeof(hnode_t) + _heap.last->size -
+           _heap.start;
+}
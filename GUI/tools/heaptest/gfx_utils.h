@@ -0,0 +1,13 @@
+/*
+ * Host stand-in for the BDK gfx header. heap.c only prints node stats with
+ * gfx_printf
+ */
+
+#ifndef _GFX_UTILS_H_
+#define _GFX_UTILS_H_
+
+#include <stdio.h>
+
+#define gfx_printf printf
+
+#endif
@@ -0,0 +1,317 @@
+/*
+ * SD Card Read Tester - BDK heap stress test and benchmark (host tool)
+ * Copyright (c) 2026
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+// Runs bdk/mem/heap.c on the host. The stress test replays random
+// malloc/calloc/free with data patterns and checks the node list, the size
+// class lists and the accounting after every batch. The benchmark replays the
+// same kind of trace through the BDK heap, the first-fit heap it replaced and
+// the host allocator, with the fragmentation left at the end of the trace.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Renamed at build time, see Makefile. The BDK free prototype matches the host
+// one, so it is declared by hand and heap_t keeps its free lists member name
+#define malloc heap_malloc
+#define calloc heap_calloc
+#define zalloc heap_zalloc
+#include <mem/heap.h>
+#undef malloc
+#undef calloc
+#undef zalloc
+
+void heap_free(void *buf);
+
+extern heap_t _heap;
+
+// First-fit baseline, see firstfit.c
+void ff_heap_init(void *base);
+void *ff_malloc(u32 size);
+void ff_free(void *buf);
+void ff_heap_get_stats(u32 *used, u32 *free_bytes, u32 *largest_free,
+                       u32 *top);
+
+#define ARENA_SIZE (512u << 20)
+#define SLOTS 4000          // Live allocations at most
+#define CHECK_EVERY 10000   // Operations between full heap checks
+#define DEFAULT_OPS 2000000
+
+typedef struct {
+  uint8_t *buf;
+  uint32_t size;
+  uint8_t fill;
+} slot_t;
+
+// Heap state at the end of a benchmark trace, before the cleanup
+typedef struct {
+  uint32_t used;
+  uint32_t free;
+  uint32_t largest_free;
+  uint32_t top;
+} bench_stats_t;
+
+typedef struct {
+  const char *name;
+  void (*init)(void *base);
+  void *(*alloc)(u32 size);
+  void (*release)(void *buf);
+  void (*stats)(bench_stats_t *st); // NULL for the host allocator
+} allocator_t;
+
+static uint8_t *arena;
+static slot_t slots[SLOTS];
+static uint32_t rng_state = 1;
+
+static uint32_t rng_next(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+// Mostly small LVGL/string sized requests, some large buffers
+static uint32_t rand_size(void) {
+  if (rng_next() % 8 == 0)
+    return rng_next() % 200000;
+  return rng_next() % 600 + 1;
+}
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint32_t heap_top(void) {
+  if (!_heap.last)
+    return 0;
+  return (uint8_t *)_heap.last + sizeof(hnode_t) + _heap.last->size - arena;
+}
+
+static int fail(const char *what, long op) {
+  fprintf(stderr, "heaptest: %s (op %ld)\n", what, op);
+  return 1;
+}
+
+// Walks the node list and the size class lists. Returns 0 if consistent
+static int heap_check(long op) {
+  uint32_t used = 0, allocs = 0, free_nodes = 0;
+  hnode_t *prev = NULL;
+
+  for (hnode_t *node = _heap.first; node; prev = node, node = node->next) {
+    if (node->prev != prev)
+      return fail("broken prev link", op);
+    if (node->next && (uint8_t *)node->next !=
+                          (uint8_t *)node + sizeof(hnode_t) + node->size)
+      return fail("gap or overlap between nodes", op);
+    if ((uintptr_t)node % sizeof(hnode_t) || node->size % sizeof(hnode_t))
+      return fail("unaligned node", op);
+
+    if (node->used) {
+      used += node->size + sizeof(hnode_t);
+      allocs++;
+    } else {
+      if (prev && !prev->used)
+        return fail("free nodes not coalesced", op);
+      free_nodes++;
+    }
+  }
+
+  if (_heap.last != prev)
+    return fail("stale last node", op);
+  if (used != _heap.used || allocs != _heap.allocs)
+    return fail("used/allocs accounting", op);
+
+  uint32_t listed = 0;
+  for (uint32_t fl = 0; fl < HEAP_FL_COUNT; fl++) {
+    for (uint32_t sl = 0; sl < HEAP_SL_COUNT; sl++) {
+      hnode_t *head = _heap.free[fl][sl];
+      int bit = !!(_heap.sl_bitmap[fl] & (1u << sl));
+      if (bit != !!head)
+        return fail("second level bitmap out of sync", op);
+
+      for (hnode_t *node = head; node; node = node->free_next) {
+        if (node->used)
+          return fail("used node in a free list", op);
+        if (node->free_next && node->free_next->free_prev != node)
+          return fail("broken free list link", op);
+        listed++;
+      }
+    }
+
+    if (!!(_heap.fl_bitmap & (1u << fl)) != !!_heap.sl_bitmap[fl])
+      return fail("first level bitmap out of sync", op);
+  }
+
+  if (listed != free_nodes)
+    return fail("free node missing from the class lists", op);
+
+  return 0;
+}
+
+static int check_slot(slot_t *s) {
+  for (uint32_t i = 0; i < s->size; i++)
+    if (s->buf[i] != s->fill)
+      return 0;
+  return 1;
+}
+
+static int run_stress(long ops) {
+  heap_init(arena);
+  memset(slots, 0, sizeof(slots));
+
+  for (long op = 0; op < ops; op++) {
+    slot_t *s = &slots[rng_next() % SLOTS];
+
+    if (s->buf) {
+      if (!check_slot(s))
+        return fail("allocation overwritten", op);
+
+      heap_free(s->buf);
+      if (rng_next() % 64 == 0)
+        heap_free(s->buf); // Double frees are ignored
+      s->buf = NULL;
+    } else {
+      s->size = rand_size();
+      if (rng_next() % 4 == 0) {
+        s->buf = heap_calloc(1, s->size);
+        s->fill = 0;
+        if (!check_slot(s))
+          return fail("calloc memory not cleared", op);
+      } else {
+        s->buf = heap_malloc(s->size);
+        s->fill = rng_next();
+      }
+
+      if ((uintptr_t)s->buf % sizeof(hnode_t))
+        return fail("unaligned allocation", op);
+      if (heap_top() > ARENA_SIZE)
+        return fail("arena exhausted", op);
+      memset(s->buf, s->fill, s->size);
+    }
+
+    if (op % CHECK_EVERY == 0 && heap_check(op))
+      return 1;
+  }
+
+  for (uint32_t i = 0; i < SLOTS; i++) {
+    if (slots[i].buf) {
+      heap_free(slots[i].buf);
+      slots[i].buf = NULL;
+    }
+  }
+
+  if (heap_check(ops))
+    return 1;
+  if (_heap.used || _heap.allocs || _heap.first != _heap.last)
+    return fail("heap not empty after freeing everything", ops);
+
+  heap_stats_t stats;
+  heap_get_stats(&stats);
+  printf("stress: %ld ops ok, peak %u KB, top %u KB\n", ops, stats.peak / 1024,
+         heap_top() / 1024);
+
+  return 0;
+}
+
+static void bdk_stats(bench_stats_t *st) {
+  heap_stats_t stats;
+  heap_get_stats(&stats);
+  st->used = stats.used;
+  st->free = stats.free;
+  st->largest_free = stats.largest_free;
+  st->top = heap_top();
+}
+
+static void ff_stats(bench_stats_t *st) {
+  ff_heap_get_stats(&st->used, &st->free, &st->largest_free, &st->top);
+}
+
+static void *host_alloc(u32 size) { return malloc(size); }
+
+static const allocator_t allocators[] = {
+    {"bdk heap", heap_init, heap_malloc, heap_free, bdk_stats},
+    {"first-fit", ff_heap_init, ff_malloc, ff_free, ff_stats},
+    {"host malloc", NULL, host_alloc, free, NULL},
+};
+
+// Same seed, so every allocator replays the same trace
+static uint64_t run_bench(long ops, const allocator_t *a, bench_stats_t *st) {
+  rng_state = 1;
+  if (a->init)
+    a->init(arena);
+  memset(slots, 0, sizeof(slots));
+
+  uint64_t start = now_ns();
+  for (long op = 0; op < ops; op++) {
+    slot_t *s = &slots[rng_next() % SLOTS];
+
+    if (s->buf) {
+      a->release(s->buf);
+      s->buf = NULL;
+    } else {
+      s->size = rand_size();
+      s->buf = a->alloc(s->size);
+      if (s->size)
+        s->buf[0] = 1; // Touch it like a real user would
+    }
+  }
+  uint64_t ns = now_ns() - start;
+
+  if (a->stats)
+    a->stats(st);
+
+  for (uint32_t i = 0; i < SLOTS; i++) {
+    if (slots[i].buf) {
+      a->release(slots[i].buf);
+      slots[i].buf = NULL;
+    }
+  }
+
+  return ns;
+}
+
+int main(int argc, char **argv) {
+  long ops = argc > 1 ? strtol(argv[1], NULL, 0) : DEFAULT_OPS;
+  if (argc > 2 || ops <= 0) {
+    fprintf(stderr, "Usage: %s [ops]\n", argv[0]);
+    return 1;
+  }
+
+  arena = aligned_alloc(sizeof(hnode_t), ARENA_SIZE);
+  if (!arena) {
+    fprintf(stderr, "heaptest: cannot allocate the arena\n");
+    return 1;
+  }
+
+  int res = run_stress(ops);
+  for (uint32_t i = 0; !res && i < sizeof(allocators) / sizeof(allocators[0]);
+       i++) {
+    bench_stats_t st;
+    uint64_t ns = run_bench(ops, &allocators[i], &st);
+
+    printf("bench: %-11s %6llu ms, %6llu Kops/s", allocators[i].name,
+           (unsigned long long)(ns / 1000000),
+           (unsigned long long)(ops * 1000000ULL / (ns ? ns : 1)));
+    if (allocators[i].stats)
+      printf(", top %u KB, free %u KB, largest free %u KB, frag %u.%u%%",
+             st.top / 1024, st.free / 1024, st.largest_free / 1024,
+             (u32)((uint64_t)(st.free - st.largest_free) * 1000 /
+                   (st.free ? st.free : 1)) / 10,
+             (u32)((uint64_t)(st.free - st.largest_free) * 1000 /
+                   (st.free ? st.free : 1)) % 10);
+    printf("\n");
+  }
+
+  free(arena);
+  return res;
+}
@@ -0,0 +1,99 @@
+/*
+ * SD Card Read Tester - LZ4 payload packer (host tool)
+ * Copyright (c) 2026
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+// Packs a payload image for the stub as one LZ4 block behind a small header.
+// Built against the BDK lz4.c, so the stub decompresses exactly this format.
+// The output is unpacked again and compared before it is written.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lz4.h"
+
+// Must match stub_pack_hdr_t and STUB_IMAGE_SZ_MAX in source/stub.h
+#define STUB_PACK_MAGIC 0x50345A4C // "LZ4P"
+#define STUB_IMAGE_SZ_MAX ((16u << 20) - 4096) // NYX_SZ_MAX - SZ_4K
+
+typedef struct {
+  uint32_t magic;
+  uint32_t raw_size;
+  uint32_t packed_size;
+  uint32_t rsvd;
+} pack_hdr_t;
+
+static void *read_file(const char *path, long *size) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp)
+    return NULL;
+
+  fseek(fp, 0, SEEK_END);
+  *size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+
+  void *buf = malloc(*size);
+  if (buf && fread(buf, 1, *size, fp) != (size_t)*size) {
+    free(buf);
+    buf = NULL;
+  }
+  fclose(fp);
+
+  return buf;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s <image.bin> <packed.lz4>\n", argv[0]);
+    return 1;
+  }
+
+  long raw_size;
+  char *raw = read_file(argv[1], &raw_size);
+  if (!raw) {
+    fprintf(stderr, "lz4pack: cannot read %s\n", argv[1]);
+    return 1;
+  }
+
+  // The stub panics on anything it cannot unpack below its info block
+  if (raw_size <= 0 || raw_size > STUB_IMAGE_SZ_MAX) {
+    fprintf(stderr, "lz4pack: %s is %ld bytes, must be 1 to %u\n", argv[1],
+            raw_size, STUB_IMAGE_SZ_MAX);
+    return 1;
+  }
+
+  int bound = LZ4_compressBound(raw_size);
+  char *packed = malloc(bound);
+  char *check = malloc(raw_size);
+  if (!packed || !check)
+    return 1;
+
+  int packed_size = LZ4_compress_default(raw, packed, raw_size, bound);
+  if (packed_size <= 0 ||
+      LZ4_decompress_safe(packed, check, packed_size, raw_size) != raw_size ||
+      memcmp(raw, check, raw_size)) {
+    fprintf(stderr, "lz4pack: round trip of %s failed\n", argv[1]);
+    return 1;
+  }
+
+  pack_hdr_t hdr = {STUB_PACK_MAGIC, raw_size, packed_size, 0};
+
+  FILE *fp = fopen(argv[2], "wb");
+  if (!fp || fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+      fwrite(packed, 1, packed_size, fp) != (size_t)packed_size) {
+    fprintf(stderr, "lz4pack: cannot write %s\n", argv[2]);
+    return 1;
+  }
+  fclose(fp);
+
+  printf("Packed %ld bytes to %d bytes (%ld%%)\n", raw_size, packed_size,
+         packed_size * 100L / raw_size);
+
+  return 0;
+}
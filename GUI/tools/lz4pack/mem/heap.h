@@ -0,0 +1,15 @@
+/*
+ * Host stand-in for the BDK heap header. lz4.c gets its allocators and the
+ * BDK types (BYTE, likely/unlikely) through it
+ */
+
+#ifndef _HEAP_H_
+#define _HEAP_H_
+
+#include <stdlib.h>
+
+#include <utils/types.h>
+
+#define zalloc(size) calloc(1, size)
+
+#endif
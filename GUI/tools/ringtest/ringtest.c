@@ -0,0 +1,204 @@
+/*
+ * SD Card Read Tester - CCPLEX worker ring test (host tool)
+ * Copyright (c) 2026
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+// Runs the worker ring protocol of source/worker_ring.h between two threads.
+// The main thread plays the BPMP client of source/worker.c, a pthread stands
+// in for worker/main.c: it waits for the magic, reports ready, serves commands
+// in order and exits on WORKER_OP_EXIT. Every command carries fields derived
+// from its tag, and every completion a result derived from them, so a slot
+// read before it is fully published or reused too early shows up as a
+// mismatch. The ring is small next to the command count, so both rings run
+// full and empty many times.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Full fence on both sides. The BPMP maps the ring uncached and the worker
+// uses dmb, a host thread needs both the compiler and the CPU ordered
+#define WORKER_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#include "worker_ring.h"
+
+#include "config.h"
+
+#define DEFAULT_CMDS 200000
+#define ALIGN_ERR_EVERY 61 // Misaligned commands, answered with an error
+
+static worker_ring_t *ring;
+static u32 worker_bad;
+
+static void cmd_for_tag(u32 tag, worker_cmd_t *cmd) {
+  memset(cmd, 0, sizeof(*cmd));
+  cmd->op = WORKER_OP_NOP;
+  cmd->tag = tag;
+  cmd->src = tag << 4;
+  cmd->dst = ~tag << 4;
+  cmd->size = (tag % ALIGN_ERR_EVERY) ? (tag & 0xFFF0) : 8;
+  cmd->arg = tag * 0x9E3779B9;
+}
+
+static u32 cmd_result(const worker_cmd_t *cmd) {
+  return cmd->src ^ cmd->dst ^ cmd->size ^ cmd->arg;
+}
+
+// Same dispatch as worker_main, with NOP as the only compute op
+static void *worker_thread(void *param) {
+  while (__atomic_load_n(&ring->magic, __ATOMIC_ACQUIRE) != WORKER_RING_MAGIC)
+    sched_yield();
+
+  ring->state = WORKER_STATE_READY;
+
+  u32 expect = 0;
+  while (1) {
+    worker_cmd_t cmd;
+    if (!worker_ring_pop_cmd(ring, &cmd)) {
+      sched_yield();
+      continue;
+    }
+
+    // Commands arrive in order and intact
+    worker_cmd_t want;
+    cmd_for_tag(expect++, &want);
+    if (cmd.op != WORKER_OP_EXIT && memcmp(&cmd, &want, sizeof(cmd)))
+      worker_bad++;
+
+    worker_cpl_t cpl = {0};
+    cpl.tag = cmd.tag;
+    cpl.detail = 0xFFFFFFFF;
+
+    if ((cmd.src | cmd.dst | cmd.size) & 15) {
+      cpl.status = WORKER_ERR_ALIGN;
+    } else if (cmd.op != WORKER_OP_NOP && cmd.op != WORKER_OP_EXIT) {
+      cpl.status = WORKER_ERR_OP;
+    } else {
+      cpl.result = cmd_result(&cmd);
+    }
+
+    while (!worker_ring_push_cpl(ring, &cpl))
+      sched_yield();
+
+    if (cmd.op == WORKER_OP_EXIT)
+      break;
+  }
+
+  ring->state = WORKER_STATE_EXITED;
+  return NULL;
+}
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  long cmds = argc > 1 ? strtol(argv[1], NULL, 0) : DEFAULT_CMDS;
+  if (argc > 2 || cmds <= 0 || cmds >= 0x7FFFFFFF) {
+    fprintf(stderr, "Usage: %s [commands]\n", argv[0]);
+    return 1;
+  }
+
+  ring = aligned_alloc(WORKER_RING_LINE,
+                       ALIGN(sizeof(worker_ring_t), WORKER_RING_LINE));
+  if (!ring) {
+    fprintf(stderr, "ringtest: cannot allocate the ring\n");
+    return 1;
+  }
+  memset(ring, 0, sizeof(worker_ring_t));
+
+  pthread_t worker;
+  if (pthread_create(&worker, NULL, worker_thread, NULL)) {
+    fprintf(stderr, "ringtest: cannot start the worker thread\n");
+    return 1;
+  }
+
+  // Same start handshake as worker_start
+  __atomic_store_n(&ring->magic, WORKER_RING_MAGIC, __ATOMIC_RELEASE);
+  while (ring->state != WORKER_STATE_READY)
+    sched_yield();
+
+  u32 issued = 0, completed = 0, bad = 0, full = 0, align_errs = 0;
+  uint64_t start = now_ns();
+
+  while (completed < cmds) {
+    u32 progress = issued + completed;
+
+    while (issued < cmds) {
+      worker_cmd_t cmd;
+      cmd_for_tag(issued, &cmd);
+      if (!worker_ring_push_cmd(ring, &cmd)) {
+        full++;
+        break;
+      }
+      issued++;
+    }
+
+    worker_cpl_t cpl;
+    while (worker_ring_pop_cpl(ring, &cpl)) {
+      worker_cmd_t cmd;
+      cmd_for_tag(completed, &cmd);
+
+      if (cpl.tag != completed)
+        bad++;
+      else if (cmd.size & 15)
+        bad += cpl.status != WORKER_ERR_ALIGN, align_errs++;
+      else
+        bad += cpl.status != WORKER_OK || cpl.result != cmd_result(&cmd) ||
+               cpl.detail != 0xFFFFFFFF;
+      completed++;
+    }
+
+    // Let the worker run if it is behind, hosts may have a single CPU
+    if (issued + completed == progress)
+      sched_yield();
+  }
+
+  uint64_t ns = now_ns() - start;
+
+  // Same stop as worker_stop
+  worker_cmd_t cmd = {0};
+  cmd.op = WORKER_OP_EXIT;
+  cmd.tag = issued;
+  while (!worker_ring_push_cmd(ring, &cmd))
+    sched_yield();
+
+  // A worker that missed the exit keeps polling, so it is not joined then
+  uint64_t timeout = now_ns() + WORKER_TIMEOUT_MS * 1000000ULL;
+  while (ring->state != WORKER_STATE_EXITED && now_ns() < timeout)
+    sched_yield();
+  if (ring->state != WORKER_STATE_EXITED) {
+    fprintf(stderr, "ringtest: worker did not exit, %u bad commands\n",
+            worker_bad);
+    return 1;
+  }
+  pthread_join(worker, NULL);
+
+  worker_cpl_t cpl;
+  if (!worker_ring_pop_cpl(ring, &cpl) || cpl.tag != issued)
+    bad++;
+
+  printf("ring: %ld commands, %u alignment errors, ring full %u times, %llu "
+         "ns per round trip\n",
+         cmds, align_errs, full, (unsigned long long)(ns / cmds));
+
+  if (bad || worker_bad) {
+    fprintf(stderr, "ringtest: %u bad completions, %u bad commands\n", bad,
+            worker_bad);
+    free(ring);
+    return 1;
+  }
+  printf("ring: ok\n");
+
+  free(ring);
+  return 0;
+}
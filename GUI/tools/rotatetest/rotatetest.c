@@ -0,0 +1,143 @@
+/*
+ * SD Card Read Tester - Display rotation test and benchmark (host tool)
+ * Copyright (c) 2026
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+// Checks source/rotate.c against a per pixel rotation for random and edge
+// case areas, including that nothing outside the area is written, then times
+// both on typical LVGL flush areas.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "config.h"
+#include "rotate.h"
+
+#define FB_W 720
+#define FB_H 1280
+#define FB_SZ (FB_W * FB_H * sizeof(u32))
+#define RANDOM_AREAS 2000
+#define SENTINEL 0xDEADBEEF
+
+static u32 *fb_ref, *fb_test, *src;
+
+// LVGL(x,y) -> FB(y, 1279-x), one pixel at a time
+static void rotate_ref(u32 *fb, s32 x1, s32 y1, s32 x2, s32 y2,
+                       const u32 *p) {
+  for (s32 y = y1; y <= y2; y++)
+    for (s32 x = x1; x <= x2; x++)
+      fb[(1279 - x) * FB_W + y] = *p++;
+}
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int check_area(s32 x1, s32 y1, s32 x2, s32 y2) {
+  for (u32 i = 0; i < FB_W * FB_H; i++)
+    fb_ref[i] = fb_test[i] = SENTINEL;
+
+  rotate_ref(fb_ref, x1, y1, x2, y2, src);
+  rotate_area(fb_test, FB_W, x1, y1, x2, y2, src);
+
+  if (memcmp(fb_ref, fb_test, FB_SZ)) {
+    fprintf(stderr, "rotatetest: mismatch in area %d,%d - %d,%d\n", x1, y1,
+            x2, y2);
+    return 1;
+  }
+  return 0;
+}
+
+static int run_checks(void) {
+  // Single pixels, lines, tile edges and the whole screen
+  static const s32 edges[][4] = {
+      {0, 0, 0, 0},
+      {1279, 719, 1279, 719},
+      {0, 0, 1279, 0},
+      {0, 0, 0, 719},
+      {0, 0, FLUSH_TILE - 1, FLUSH_TILE - 1},
+      {1, 1, FLUSH_TILE, FLUSH_TILE},
+      {FLUSH_TILE - 1, 3, 3 * FLUSH_TILE + 1, 2 * FLUSH_TILE},
+      {1264, 704, 1279, 719},
+      {0, 0, 1279, 719},
+  };
+
+  for (u32 i = 0; i < sizeof(edges) / sizeof(edges[0]); i++)
+    if (check_area(edges[i][0], edges[i][1], edges[i][2], edges[i][3]))
+      return 1;
+
+  srand(1);
+  for (u32 i = 0; i < RANDOM_AREAS; i++) {
+    s32 x1 = rand() % 1280, x2 = rand() % 1280;
+    s32 y1 = rand() % 720, y2 = rand() % 720;
+    if (check_area(MIN(x1, x2), MIN(y1, y2), MAX(x1, x2), MAX(y1, y2)))
+      return 1;
+  }
+
+  printf("check: %d areas ok (tile %d)\n",
+         (int)(sizeof(edges) / sizeof(edges[0])) + RANDOM_AREAS, FLUSH_TILE);
+  return 0;
+}
+
+static void run_bench(void) {
+  static const struct {
+    const char *name;
+    s32 x1, y1, x2, y2;
+    u32 loops;
+  } areas[] = {
+      {"full screen", 0, 0, 1279, 719, 100},
+      {"480x320", 400, 200, 879, 519, 1000},
+      {"1280x20", 0, 700, 1279, 719, 1000},
+      {"20x720", 600, 0, 619, 719, 1000},
+  };
+
+  for (u32 i = 0; i < sizeof(areas) / sizeof(areas[0]); i++) {
+    s32 x1 = areas[i].x1, y1 = areas[i].y1;
+    s32 x2 = areas[i].x2, y2 = areas[i].y2;
+
+    uint64_t start = now_ns();
+    for (u32 n = 0; n < areas[i].loops; n++)
+      rotate_ref(fb_ref, x1, y1, x2, y2, src);
+    uint64_t ref_ns = (now_ns() - start) / areas[i].loops;
+
+    start = now_ns();
+    for (u32 n = 0; n < areas[i].loops; n++)
+      rotate_area(fb_test, FB_W, x1, y1, x2, y2, src);
+    uint64_t tile_ns = (now_ns() - start) / areas[i].loops;
+
+    printf("bench %-11s: per pixel %5llu us, tiled %5llu us\n", areas[i].name,
+           (unsigned long long)(ref_ns / 1000),
+           (unsigned long long)(tile_ns / 1000));
+  }
+}
+
+int main(void) {
+  fb_ref = malloc(FB_SZ);
+  fb_test = malloc(FB_SZ);
+  src = malloc(FB_SZ);
+  if (!fb_ref || !fb_test || !src) {
+    fprintf(stderr, "rotatetest: out of memory\n");
+    return 1;
+  }
+
+  for (u32 i = 0; i < FB_W * FB_H; i++)
+    src[i] = i * 2654435761u;
+
+  int res = run_checks();
+  if (!res)
+    run_bench();
+
+  free(fb_ref);
+  free(fb_test);
+  free(src);
+  return res;
+}
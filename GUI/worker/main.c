@@ -0,0 +1,222 @@
+/*
+ * SD Card Read Tester - CCPLEX worker
+ * Copyright (c) 2026
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+// Runs on CPU0 at EL3 and serves the command ring until told to exit. DRAM
+// is mapped cacheable except for the ring block, and buffers are cleaned and
+// invalidated by line around each command since the BPMP and the SDMMC DMA
+// are not coherent with the CCPLEX caches.
+
+#include <arm_acle.h>
+#include <arm_neon.h>
+
+#include <utils/types.h>
+
+#include "worker_ring.h"
+
+#define LINE_SIZE 64
+
+// Long descriptor format, 4 KB granule, 32-bit address space
+#define DESC_BLOCK (1 << 0)
+#define DESC_TABLE (3 << 0)
+#define DESC_ATTR(n) ((n) << 2)
+#define DESC_SH_INNER (3 << 8)
+#define DESC_AF (1 << 10)
+#define DESC_XN ((u64)3 << 53)
+
+#define ATTR_DEVICE 0 // Device-nGnRnE
+#define ATTR_NORMAL 1 // Write back, read/write allocate
+#define ATTR_NORMAL_NC 2
+#define MAIR_VALUE ((0x00 << 0) | (0xFF << 8) | (0x44 << 16))
+
+#define TCR_VALUE                                                              \
+  ((1u << 31) | (1 << 23) | (3 << 12) | (1 << 10) | (1 << 8) | 32)
+
+static worker_ring_t *ring = (worker_ring_t *)WORKER_RING_ADDR;
+
+static u64 l1_table[4] __attribute__((aligned(32)));
+static u64 l2_table[512] __attribute__((aligned(4096)));
+
+// The compiler may emit calls to these for struct copies
+void *memcpy(void *dst, const void *src, unsigned long size) {
+  u8 *d = dst;
+  const u8 *s = src;
+  while (size--)
+    *d++ = *s++;
+  return dst;
+}
+
+void *memset(void *dst, int val, unsigned long size) {
+  u8 *d = dst;
+  while (size--)
+    *d++ = val;
+  return dst;
+}
+
+// Identity map: 0-2 GB device (MMIO, IRAM), 2-3 GB normal, 3-4 GB normal in
+// 2 MB blocks so the ring block can be uncached
+void worker_mmu_init(void) {
+  l1_table[0] = 0x00000000 | DESC_BLOCK | DESC_ATTR(ATTR_DEVICE) | DESC_AF |
+                DESC_XN;
+  l1_table[1] = 0x40000000 | DESC_BLOCK | DESC_ATTR(ATTR_DEVICE) | DESC_AF |
+                DESC_XN;
+  l1_table[2] = 0x80000000 | DESC_BLOCK | DESC_ATTR(ATTR_NORMAL) |
+                DESC_SH_INNER | DESC_AF;
+  l1_table[3] = (u64)(unsigned long)l2_table | DESC_TABLE;
+
+  for (u32 i = 0; i < 512; i++) {
+    u64 addr = 0xC0000000ull + ((u64)i << 21);
+    u32 attr = addr == WORKER_RING_ADDR ? ATTR_NORMAL_NC : ATTR_NORMAL;
+    l2_table[i] = addr | DESC_BLOCK | DESC_ATTR(attr) | DESC_SH_INNER | DESC_AF;
+  }
+
+  // Caches are invalidated by hardware on reset
+  __asm__ volatile("msr mair_el3, %0" ::"r"((u64)MAIR_VALUE));
+  __asm__ volatile("msr tcr_el3, %0" ::"r"((u64)TCR_VALUE));
+  __asm__ volatile("msr ttbr0_el3, %0" ::"r"((u64)(unsigned long)l1_table));
+  __asm__ volatile("dsb sy\n\ttlbi alle3\n\tdsb sy\n\tisb" ::: "memory");
+
+  // MMU, data and instruction caches on, alignment checks off
+  u64 sctlr;
+  __asm__ volatile("mrs %0, sctlr_el3" : "=r"(sctlr));
+  sctlr |= (1 << 0) | (1 << 2) | (1 << 12);
+  sctlr &= ~(u64)(1 << 1);
+  __asm__ volatile("msr sctlr_el3, %0\n\tisb" ::"r"(sctlr) : "memory");
+}
+
+// Drops stale lines before reading DMA/BPMP written data and pushes results
+// out for the BPMP. Clean and invalidate covers both
+static void dcache_flush(u32 addr, u32 size) {
+  for (u64 line = addr & ~(LINE_SIZE - 1); line < (u64)addr + size;
+       line += LINE_SIZE)
+    __asm__ volatile("dc civac, %0" ::"r"(line) : "memory");
+  __asm__ volatile("dsb sy" ::: "memory");
+}
+
+static void op_fill(worker_cmd_t *cmd) {
+  u32 *dst = (u32 *)(unsigned long)cmd->dst;
+  u32 words = cmd->size / 4;
+
+  const u32 lanes[4] = {0, 1, 2, 3};
+  uint32x4_t step = vdupq_n_u32(4 * 0x9E3779B9);
+  uint32x4_t pat = vmlaq_n_u32(vdupq_n_u32(cmd->arg), vld1q_u32(lanes),
+                               0x9E3779B9);
+
+  for (u32 i = 0; i < words; i += 4) {
+    vst1q_u32(&dst[i], pat);
+    pat = vaddq_u32(pat, step);
+  }
+
+  dcache_flush(cmd->dst, cmd->size);
+}
+
+static void op_verify(worker_cmd_t *cmd, worker_cpl_t *cpl) {
+  const u32 *src = (const u32 *)(unsigned long)cmd->src;
+  u32 words = cmd->size / 4;
+
+  dcache_flush(cmd->src, cmd->size);
+
+  const u32 lanes[4] = {0, 1, 2, 3};
+  uint32x4_t step = vdupq_n_u32(4 * 0x9E3779B9);
+  uint32x4_t pat = vmlaq_n_u32(vdupq_n_u32(cmd->arg), vld1q_u32(lanes),
+                               0x9E3779B9);
+
+  cpl->detail = 0xFFFFFFFF;
+  for (u32 i = 0; i < words; i += 4) {
+    uint32x4_t diff = veorq_u32(vld1q_u32(&src[i]), pat);
+    pat = vaddq_u32(pat, step);
+
+    // Only count per word when something differs
+    if (vmaxvq_u32(diff)) {
+      for (u32 j = i; j < i + 4; j++) {
+        if (src[j] != WORKER_PATTERN(cmd->arg, j)) {
+          if (cpl->detail == 0xFFFFFFFF)
+            cpl->detail = j * 4;
+          cpl->result++;
+        }
+      }
+    }
+  }
+}
+
+static void op_crc32(worker_cmd_t *cmd, worker_cpl_t *cpl) {
+  const u64 *src = (const u64 *)(unsigned long)cmd->src;
+  u32 crc = ~cmd->arg;
+
+  dcache_flush(cmd->src, cmd->size);
+
+  // Sizes are multiples of 16, so no tail
+  for (u32 i = 0; i < cmd->size / 8; i++)
+    crc = __crc32d(crc, src[i]);
+
+  cpl->result = ~crc;
+}
+
+static void op_hist_merge(worker_cmd_t *cmd) {
+  const u32 *src = (const u32 *)(unsigned long)cmd->src;
+  u32 *dst = (u32 *)(unsigned long)cmd->dst;
+
+  dcache_flush(cmd->src, cmd->size);
+  dcache_flush(cmd->dst, cmd->size);
+
+  for (u32 i = 0; i < cmd->size / 4; i += 4)
+    vst1q_u32(&dst[i], vaddq_u32(vld1q_u32(&dst[i]), vld1q_u32(&src[i])));
+
+  dcache_flush(cmd->dst, cmd->size);
+}
+
+void worker_main(void) {
+  if (ring->magic != WORKER_RING_MAGIC)
+    return;
+
+  ring->state = WORKER_STATE_READY;
+
+  while (1) {
+    worker_cmd_t cmd;
+    if (!worker_ring_pop_cmd(ring, &cmd)) {
+      __asm__ volatile("yield");
+      continue;
+    }
+
+    worker_cpl_t cpl = {0};
+    cpl.tag = cmd.tag;
+
+    if ((cmd.src | cmd.dst | cmd.size) & 15) {
+      cpl.status = WORKER_ERR_ALIGN;
+    } else {
+      switch (cmd.op) {
+      case WORKER_OP_NOP:
+      case WORKER_OP_EXIT:
+        break;
+      case WORKER_OP_FILL:
+        op_fill(&cmd);
+        break;
+      case WORKER_OP_VERIFY:
+        op_verify(&cmd, &cpl);
+        break;
+      case WORKER_OP_CRC32:
+        op_crc32(&cmd, &cpl);
+        break;
+      case WORKER_OP_HIST_MERGE:
+        op_hist_merge(&cmd);
+        break;
+      default:
+        cpl.status = WORKER_ERR_OP;
+        break;
+      }
+    }
+
+    while (!worker_ring_push_cpl(ring, &cpl))
+      ;
+
+    if (cmd.op == WORKER_OP_EXIT)
+      break;
+  }
+
+  ring->state = WORKER_STATE_EXITED;
+}